@@ -0,0 +1,39 @@
+/*
+ * bench.h: counters shared by the crystalhd bench and its stand-ins
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+struct bench_counters {
+  /* heap allocations done by the code under test */
+  uint64_t mallocs;
+  uint64_t callocs;
+  uint64_t reallocs;
+  uint64_t vallocs;
+  /* bytes moved through xine_fast_memcpy */
+  uint64_t bytes_copied;
+  /* data handed to the stand-in hardware */
+  uint64_t packets_sent;
+  uint64_t bytes_sent;
+  uint32_t decoder_starts;
+};
+
+extern struct bench_counters bench_counters;
+
+/* time the stand-in hardware spends in DtsProcInput */
+extern unsigned int bench_input_latency_us;
+
+/* from now on the stand-in hardware makes a picture ready every period_us,
+ * frames pictures in total */
+void bench_output_start(uint32_t period_us, uint32_t frames);
+
+struct xine_s;
+
+/* runs the parser benchmark called name, non-zero if one of its checks
+ * failed or there is none of that name */
+int bench_parser(struct xine_s *xine, const char *name);
+
+#endif
@@ -0,0 +1,183 @@
+/*
+ * bench_dts.c: stand-in for libcrystalhd, it accepts everything and
+ * only counts the data sent to the decoder. Once bench_output_start() was
+ * called it also delivers empty pictures at a fixed rate.
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include <bc_dts_types.h>
+#include <bc_dts_defs.h>
+#include <libcrystalhd_if.h>
+
+#include "../crystalhd_rec.h"
+#include "bench.h"
+
+static int bench_device;
+
+unsigned int bench_input_latency_us;
+
+/* picture n becomes ready at output_start_us + n * output_period_us */
+static int64_t  output_start_us;
+static uint32_t output_period_us;
+static uint32_t output_frames;
+static uint32_t output_taken;
+
+void bench_output_start(uint32_t period_us, uint32_t frames)
+{
+  output_start_us = crystalhd_rec_now();
+  output_period_us = period_us;
+  output_frames = frames;
+  output_taken = 0;
+}
+
+static uint32_t output_ready(int64_t now_us)
+{
+  uint32_t made;
+
+  if(!output_period_us || now_us < output_start_us)
+    return 0;
+
+  made = (now_us - output_start_us) / output_period_us + 1;
+  if(made > output_frames)
+    made = output_frames;
+
+  return made - output_taken;
+}
+
+static void sleep_until(int64_t us)
+{
+  struct timespec ts;
+
+  ts.tv_sec = us / 1000000;
+  ts.tv_nsec = (us % 1000000) * 1000;
+  clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+BC_STATUS DtsDeviceOpen(HANDLE *hDevice, uint32_t mode)
+{
+  *hDevice = &bench_device;
+  return BC_STS_SUCCESS;
+}
+
+BC_STATUS DtsDeviceClose(HANDLE hDevice)
+{
+  return BC_STS_SUCCESS;
+}
+
+BC_STATUS DtsOpenDecoder(HANDLE hDevice, uint32_t StreamType)
+{
+  return BC_STS_SUCCESS;
+}
+
+BC_STATUS DtsStartDecoder(HANDLE hDevice)
+{
+  bench_counters.decoder_starts++;
+  return BC_STS_SUCCESS;
+}
+
+BC_STATUS DtsStopDecoder(HANDLE hDevice)
+{
+  return BC_STS_SUCCESS;
+}
+
+BC_STATUS DtsCloseDecoder(HANDLE hDevice)
+{
+  return BC_STS_SUCCESS;
+}
+
+BC_STATUS DtsStartCapture(HANDLE hDevice)
+{
+  return BC_STS_SUCCESS;
+}
+
+BC_STATUS DtsFlushRxCapture(HANDLE hDevice, BOOL bDiscardOnly)
+{
+  return BC_STS_SUCCESS;
+}
+
+BC_STATUS DtsFlushInput(HANDLE hDevice, uint32_t Op)
+{
+  return BC_STS_SUCCESS;
+}
+
+BC_STATUS DtsProcInput(HANDLE hDevice, uint8_t *pUserData, uint32_t ulSizeInBytes,
+    uint64_t timeStamp, BOOL encrypted)
+{
+  bench_counters.packets_sent++;
+  bench_counters.bytes_sent += ulSizeInBytes;
+
+  if(bench_input_latency_us) {
+    struct timespec ts;
+    ts.tv_sec = bench_input_latency_us / 1000000;
+    ts.tv_nsec = (bench_input_latency_us % 1000000) * 1000;
+    nanosleep(&ts, NULL);
+  }
+
+  return BC_STS_SUCCESS;
+}
+
+BC_STATUS DtsProcOutput(HANDLE hDevice, uint32_t milliSecWait,
+    BC_DTS_PROC_OUT *pOut)
+{
+  int64_t deadline_us, next_us, now_us;
+
+  if(!output_period_us)
+    return BC_STS_NO_DATA;
+
+  now_us = crystalhd_rec_now();
+  deadline_us = now_us + milliSecWait * 1000;
+
+  while(!output_ready(now_us)) {
+    next_us = output_start_us + (int64_t)output_taken * output_period_us;
+    if(now_us >= deadline_us)
+      return BC_STS_TIMEOUT;
+    sleep_until((output_taken < output_frames && next_us < deadline_us) ?
+        next_us : deadline_us);
+    now_us = crystalhd_rec_now();
+  }
+
+  /* the time stamp carries the time the picture became ready */
+  pOut->PoutFlags |= BC_POUT_FLAGS_PIB_VALID;
+  pOut->PicInfo.picture_number = output_taken + 1;
+  pOut->PicInfo.timeStamp = output_start_us + (int64_t)output_taken * output_period_us;
+  output_taken++;
+
+  return BC_STS_SUCCESS;
+}
+
+BC_STATUS DtsProcOutputNoCopy(HANDLE hDevice, uint32_t milliSecWait,
+    BC_DTS_PROC_OUT *pOut)
+{
+  return BC_STS_NO_DATA;
+}
+
+BC_STATUS DtsReleaseOutputBuffs(HANDLE hDevice, void *Reserved, BOOL fChange)
+{
+  return BC_STS_SUCCESS;
+}
+
+BC_STATUS DtsGetDriverStatus(HANDLE hDevice, BC_DTS_STATUS *pStatus)
+{
+  uint32_t ready = output_ready(crystalhd_rec_now());
+
+  memset(pStatus, 0, sizeof(BC_DTS_STATUS));
+  pStatus->ReadyListCount = ready > 255 ? 255 : ready;
+  return BC_STS_SUCCESS;
+}
+
+BC_STATUS DtsSetColorSpace(HANDLE hDevice, uint32_t Mode422)
+{
+  return BC_STS_SUCCESS;
+}
+
+BC_STATUS DtsSetInputFormat(HANDLE hDevice, BC_INPUT_FORMAT *pInputFormat)
+{
+  return BC_STS_SUCCESS;
+}
+
+BC_STATUS DtsSetScaleParams(HANDLE hDevice, BC_SCALING_PARAMS *pScaleParams)
+{
+  return BC_STS_SUCCESS;
+}
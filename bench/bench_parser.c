@@ -0,0 +1,1394 @@
+/*
+ * bench_parser.c: microbenchmarks and checks of the demux side parsers,
+ * run by name with crystalhd_bench -B. Each one prints its results and
+ * returns non-zero if a check failed.
+ *
+ *   bits      calls per second of the 64 bit cache bit reader against the
+ *             byte loop reader it replaced, on VC-1 header field widths
+ *   golomb    H.264 slice headers per second of the CLZ Exp-Golomb decoder
+ *             against the bit by bit loop, with emulation prevention bytes
+ *   startcode GB/s of the word, SSE2 and AVX2 start code kernels against
+ *             the byte loop, after checking every kernel against the byte
+ *             loop at every alignment and tail length
+ *   scan      a 1 MB IDR picture fed in 2 kB chunks, the start code search
+ *             has to cover every byte received once, and the last two
+ *             bytes of a chunk twice
+ *   bigidr    IDR pictures of 3 MB in 4 slices fed in transport stream
+ *             packet and 2 kB chunks, each has to come out intact
+ *   avcc      the length prefixed stream of mp4 and matroska through the
+ *             in place path for 4 byte lengths and the prebuf path for 2
+ *             byte ones, against annex b, at several chunk sizes. the in
+ *             place path has to copy every byte at most once
+ *   pps       pictures per second of a stream which sends two pps before
+ *             every picture and alternates between them, repeated as they
+ *             were and with a new pic_init_qp every time
+ *   alloc     heap allocations per access unit once the parser has warmed
+ *             up, annex b and avcc, with either slice parse mode
+ *   seek      seeks per second and allocations per seek when the parser
+ *             is reset like crystalhd_video_reset does, against freeing
+ *             and creating it again like it used to
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../bits_reader.h"
+#include "../h264_parser.h"
+#include "../startcode.h"
+#include "../nal.h"
+#include "../cpb.h"
+#include "bench.h"
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* xorshift, the same data on every run */
+static uint32_t bench_random(uint32_t *state)
+{
+  uint32_t x = *state;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return *state = x;
+}
+
+static void fill_random(uint8_t *buf, int len, uint32_t seed)
+{
+  int i;
+
+  for(i = 0; i < len; i++)
+    buf[i] = bench_random(&seed) >> 24;
+}
+
+/*
+ * bits
+ */
+
+/* the reader before the 64 bit cache, one byte at a time per call */
+typedef struct {
+  uint8_t *buffer, *start;
+  int      offbits, length, oflow;
+} legacy_bits_reader_t;
+
+static void legacy_bits_reader_set(legacy_bits_reader_t *br, uint8_t *buf, int len)
+{
+  br->buffer = br->start = buf;
+  br->offbits = 0;
+  br->length = len;
+  br->oflow = 0;
+}
+
+static uint32_t legacy_read_bits(legacy_bits_reader_t *br, int nbits)
+{
+  int i, nbytes;
+  uint32_t ret = 0;
+  uint8_t *buf;
+
+  buf = br->buffer;
+  nbytes = (br->offbits + nbits)/8;
+  if(((br->offbits + nbits) %8 ) > 0)
+    nbytes++;
+  if((buf + nbytes) > (br->start + br->length)) {
+    br->oflow = 1;
+    return 0;
+  }
+  for(i=0; i<nbytes; i++)
+    ret += buf[i]<<((nbytes-i-1)*8);
+  i = (4-nbytes)*8+br->offbits;
+  ret = ((ret<<i)>>i)>>((nbytes*8)-nbits-br->offbits);
+
+  br->offbits += nbits;
+  br->buffer += br->offbits / 8;
+  br->offbits %= 8;
+
+  return ret;
+}
+
+/* field widths of a VC-1 advanced profile sequence header, the byte loop
+ * reader handles at most 25 bits at an odd offset */
+static const int bits_fields[] = {
+  2, 3, 3, 5, 1, 1, 1, 1, 12, 12, 1, 1, 1, 1, 2, 1, 14, 14, 1, 4,
+  8, 8, 1, 1, 16, 8, 4, 1, 8, 8, 8, 1, 1, 1, 1, 1, 1, 1, 1, 1, 5
+};
+#define BITS_FIELDS   (int)(sizeof(bits_fields) / sizeof(bits_fields[0]))
+#define BITS_BUF_SIZE 4096
+#define BITS_CALLS    (20 * 1000 * 1000)
+
+static int bench_bits(xine_t *xine)
+{
+  uint8_t *data = malloc(BITS_BUF_SIZE);
+  legacy_bits_reader_t lbr;
+  bits_reader_t br;
+  uint32_t legacy_sum = 0, sum = 0;
+  double start, legacy_seconds, seconds;
+  int i, f;
+
+  fill_random(data, BITS_BUF_SIZE, 1);
+
+  /* the buffer is read over and over, the last field of a pass is never
+   * beyond its end */
+  start = now();
+  legacy_bits_reader_set(&lbr, data, BITS_BUF_SIZE);
+  for(i = 0, f = 0; i < BITS_CALLS; i++) {
+    if(lbr.buffer - lbr.start > BITS_BUF_SIZE - 8) {
+      legacy_bits_reader_set(&lbr, data, BITS_BUF_SIZE);
+      f = 0;
+    }
+    legacy_sum += legacy_read_bits(&lbr, bits_fields[f]);
+    if(++f == BITS_FIELDS)
+      f = 0;
+  }
+  legacy_seconds = now() - start;
+
+  start = now();
+  bits_reader_set(&br, data, BITS_BUF_SIZE);
+  for(i = 0, f = 0; i < BITS_CALLS; i++) {
+    if(bits_tell(&br) > (BITS_BUF_SIZE - 8) * 8 + 7) {
+      bits_reader_set(&br, data, BITS_BUF_SIZE);
+      f = 0;
+    }
+    sum += read_bits(&br, bits_fields[f]);
+    if(++f == BITS_FIELDS)
+      f = 0;
+  }
+  seconds = now() - start;
+
+  printf("bits            %d read_bits calls on VC-1 header field widths\n", BITS_CALLS);
+  printf("byte loop       %.1f M calls/s\n", BITS_CALLS / legacy_seconds / 1e6);
+  printf("64 bit cache    %.1f M calls/s (%.2fx)\n", BITS_CALLS / seconds / 1e6,
+      legacy_seconds / seconds);
+
+  free(data);
+
+  if(sum != legacy_sum || br.oflow || lbr.oflow) {
+    printf("FAILED: the readers disagree, sum %08x against %08x\n", sum, legacy_sum);
+    return 1;
+  }
+  printf("both readers returned the same bits\n");
+  return 0;
+}
+
+/*
+ * writes the synthetic H.264 bitstreams of the parser benchmarks
+ */
+struct bit_writer {
+  uint8_t *buf;
+  int size;
+  int bits;
+};
+
+static void bit_writer_init(struct bit_writer *bw, uint8_t *buf, int size)
+{
+  bw->buf = buf;
+  bw->size = size;
+  bw->bits = 0;
+  memset(buf, 0, size);
+}
+
+static void put_bits(struct bit_writer *bw, uint32_t val, int len)
+{
+  while(len-- > 0) {
+    if(bw->bits / 8 >= bw->size)
+      return;
+    if((val >> len) & 1)
+      bw->buf[bw->bits / 8] |= 0x80 >> (bw->bits % 8);
+    bw->bits++;
+  }
+}
+
+static void put_ue(struct bit_writer *bw, uint32_t val)
+{
+  int len = 32 - __builtin_clz(val + 1);
+
+  put_bits(bw, 0, len - 1);
+  put_bits(bw, val + 1, len);
+}
+
+static void put_se(struct bit_writer *bw, int32_t val)
+{
+  put_ue(bw, val > 0 ? 2 * val - 1 : -2 * val);
+}
+
+/* rbsp_trailing_bits, returns the rbsp length in bytes */
+static int put_trailing_bits(struct bit_writer *bw)
+{
+  put_bits(bw, 1, 1);
+  bw->bits = (bw->bits + 7) & ~7;
+  return bw->bits / 8;
+}
+
+/* inserts the emulation prevention bytes, dst needs len * 3 / 2 bytes */
+static int nal_escape(uint8_t *dst, const uint8_t *src, int len)
+{
+  int i, n = 0, zeros = 0;
+
+  for(i = 0; i < len; i++) {
+    if(zeros >= 2 && src[i] <= 3) {
+      dst[n++] = 0x03;
+      zeros = 0;
+    }
+    zeros = src[i] ? 0 : zeros + 1;
+    dst[n++] = src[i];
+  }
+  return n;
+}
+
+/* heap allocations counted by the --wrap functions of bench_xine.c */
+static uint64_t bench_allocations(void)
+{
+  return bench_counters.mallocs + bench_counters.callocs +
+      bench_counters.reallocs + bench_counters.vallocs;
+}
+
+/*
+ * synthetic H.264 annex b streams: main profile 1080p, frame_num and
+ * pic_order_cnt_lsb coded in 4 and 8 bits, random slice data
+ */
+struct h264_stream {
+  uint8_t *buf;
+  int len;
+  int size;
+  uint32_t seed;
+};
+
+static void h264_stream_init(struct h264_stream *s, int size)
+{
+  s->buf = malloc(size);
+  s->len = 0;
+  s->size = size;
+  s->seed = 1;
+}
+
+/* appends the rbsp in bw as a nal unit with a 3 byte start code */
+static void h264_stream_nal(struct h264_stream *s, int nal_ref_idc,
+    int nal_unit_type, struct bit_writer *bw)
+{
+  int len = put_trailing_bits(bw);
+
+  if(s->len + 4 + len * 3 / 2 > s->size) {
+    fprintf(stderr, "synthetic stream larger than %d bytes\n", s->size);
+    exit(1);
+  }
+  s->buf[s->len++] = 0x00;
+  s->buf[s->len++] = 0x00;
+  s->buf[s->len++] = 0x01;
+  s->buf[s->len++] = nal_ref_idc << 5 | nal_unit_type;
+  s->len += nal_escape(s->buf + s->len, bw->buf, len);
+}
+
+static void h264_stream_sps(struct h264_stream *s, int level_idc)
+{
+  uint8_t rbsp[32];
+  struct bit_writer bw;
+
+  bit_writer_init(&bw, rbsp, sizeof(rbsp));
+  put_bits(&bw, 77, 8);       /* profile_idc */
+  put_bits(&bw, 0, 8);        /* constraint_set flags */
+  put_bits(&bw, level_idc, 8);
+  put_ue(&bw, 0);             /* seq_parameter_set_id */
+  put_ue(&bw, 0);             /* log2_max_frame_num_minus4 */
+  put_ue(&bw, 0);             /* pic_order_cnt_type */
+  put_ue(&bw, 4);             /* log2_max_pic_order_cnt_lsb_minus4 */
+  put_ue(&bw, 1);             /* num_ref_frames */
+  put_bits(&bw, 0, 1);        /* gaps_in_frame_num_value_allowed_flag */
+  put_ue(&bw, 1920 / 16 - 1);
+  put_ue(&bw, 1088 / 16 - 1);
+  put_bits(&bw, 1, 1);        /* frame_mbs_only_flag */
+  put_bits(&bw, 1, 1);        /* direct_8x8_inference_flag */
+  put_bits(&bw, 0, 1);        /* frame_cropping_flag */
+  put_bits(&bw, 0, 1);        /* vui_parameters_present_flag */
+  h264_stream_nal(s, 3, NAL_SPS, &bw);
+}
+
+static void h264_stream_pps(struct h264_stream *s, int pps_id, int qp)
+{
+  uint8_t rbsp[32];
+  struct bit_writer bw;
+
+  bit_writer_init(&bw, rbsp, sizeof(rbsp));
+  put_ue(&bw, pps_id);
+  put_ue(&bw, 0);             /* seq_parameter_set_id */
+  put_bits(&bw, 0, 1);        /* entropy_coding_mode_flag */
+  put_bits(&bw, 0, 1);        /* pic_order_present_flag */
+  put_ue(&bw, 0);             /* num_slice_groups_minus1 */
+  put_ue(&bw, 0);             /* num_ref_idx_l0_active_minus1 */
+  put_ue(&bw, 0);             /* num_ref_idx_l1_active_minus1 */
+  put_bits(&bw, 0, 1);        /* weighted_pred_flag */
+  put_bits(&bw, 0, 2);        /* weighted_bipred_idc */
+  put_se(&bw, qp - 26);       /* pic_init_qp_minus26 */
+  put_se(&bw, 0);             /* pic_init_qs_minus26 */
+  put_se(&bw, 0);             /* chroma_qp_index_offset */
+  put_bits(&bw, 1, 1);        /* deblocking_filter_control_present_flag */
+  put_bits(&bw, 0, 1);        /* constrained_intra_pred_flag */
+  put_bits(&bw, 0, 1);        /* redundant_pic_cnt_present_flag */
+  h264_stream_nal(s, 3, NAL_PPS, &bw);
+}
+
+static void h264_stream_aud(struct h264_stream *s)
+{
+  uint8_t rbsp[4];
+  struct bit_writer bw;
+
+  bit_writer_init(&bw, rbsp, sizeof(rbsp));
+  put_bits(&bw, 7, 3);        /* primary_pic_type, any slice type */
+  h264_stream_nal(s, 0, NAL_AU_DELIMITER, &bw);
+}
+
+static void h264_stream_end_of_seq(struct h264_stream *s)
+{
+  s->buf[s->len++] = 0x00;
+  s->buf[s->len++] = 0x00;
+  s->buf[s->len++] = 0x01;
+  s->buf[s->len++] = NAL_END_OF_SEQUENCE;
+}
+
+/* an IDR or P picture in slices slices of data_len bytes of slice data */
+static void h264_stream_picture(struct h264_stream *s, int idr, int frame_num,
+    int pps_id, int data_len, int slices)
+{
+  uint8_t *rbsp = malloc(data_len + 64);
+  struct bit_writer bw;
+  int i, slice;
+
+  for(slice = 0; slice < slices; slice++) {
+    bit_writer_init(&bw, rbsp, data_len + 64);
+    /* first_mb_in_slice */
+    put_ue(&bw, slice * (1920 / 16) * (1088 / 16) / slices);
+    put_ue(&bw, idr ? 7 : 5);   /* slice_type, I or P */
+    put_ue(&bw, pps_id);
+    put_bits(&bw, frame_num % 16, 4);
+    if(idr)
+      put_ue(&bw, 0);           /* idr_pic_id */
+    put_bits(&bw, (frame_num * 2) % 256, 8);
+    if(idr) {
+      put_bits(&bw, 0, 1);      /* no_output_of_prior_pics_flag */
+      put_bits(&bw, 0, 1);      /* long_term_reference_flag */
+    } else {
+      put_bits(&bw, 0, 1);      /* num_ref_idx_active_override_flag */
+      put_bits(&bw, 0, 1);      /* ref_pic_list_reordering_flag_l0 */
+      put_bits(&bw, 0, 1);      /* adaptive_ref_pic_marking_mode_flag */
+    }
+    put_se(&bw, 0);             /* slice_qp_delta */
+    put_ue(&bw, 1);             /* disable_deblocking_filter_idc */
+
+    bw.bits = (bw.bits + 7) & ~7;
+    for(i = 0; i < data_len; i++)
+      rbsp[bw.bits / 8 + i] = bench_random(&s->seed) >> 24;
+    bw.bits += data_len * 8;
+
+    h264_stream_nal(s, idr ? 3 : 2, idr ? NAL_SLICE_IDR : NAL_SLICE, &bw);
+  }
+  free(rbsp);
+}
+
+/* feeds stream through parser in chunks of chunk bytes like the decoder
+ * does, then flushes it, returns the number of access units */
+static int h264_stream_parse(struct h264_parser *parser,
+    const struct h264_stream *s, int chunk, uint32_t *max_au_len)
+{
+  uint8_t *ret_buf;
+  uint32_t ret_len;
+  struct coded_picture *ret_pic;
+  int pos = 0, len, aus = 0;
+
+  do {
+    len = s->len - pos < chunk ? s->len - pos : chunk;
+    pos += parse_frame(parser, s->buf + pos, len, 0, &ret_buf, &ret_len, &ret_pic);
+    if(ret_buf) {
+      aus++;
+      if(max_au_len && ret_len > *max_au_len)
+        *max_au_len = ret_len;
+    }
+    if(ret_pic)
+      free_coded_picture(ret_pic);
+  } while(pos < s->len || ret_buf);
+
+  return aus;
+}
+
+/*
+ * golomb
+ */
+
+/* the Exp-Golomb decoder before the CLZ one, a read_bits call per bit
+ * of the prefix on the unchanged h264_parser.c bit reader */
+static uint32_t legacy_read_rbsp_bits(struct buf_reader *buf, int len)
+{
+  static const uint32_t i_mask[33] = { 0x00, 0x01, 0x03, 0x07, 0x0f, 0x1f, 0x3f,
+      0x7f, 0xff, 0x1ff, 0x3ff, 0x7ff, 0xfff, 0x1fff, 0x3fff, 0x7fff, 0xffff,
+      0x1ffff, 0x3ffff, 0x7ffff, 0xfffff, 0x1fffff, 0x3fffff, 0x7fffff,
+      0xffffff, 0x1ffffff, 0x3ffffff, 0x7ffffff, 0xfffffff, 0x1fffffff,
+      0x3fffffff, 0x7fffffff, 0xffffffff };
+
+  int i_shr;
+  uint32_t bits = 0;
+
+  while (len > 0 && (buf->cur_pos - buf->buf) < buf->len) {
+    if ((i_shr = buf->cur_offset - len) >= 0) {
+      bits |= (*buf->cur_pos >> i_shr) & i_mask[len];
+      buf->cur_offset -= len;
+      if (buf->cur_offset == 0) {
+        buf->cur_pos++;
+        buf->cur_offset = 8;
+        if(buf->cur_pos - buf->buf > 2 && buf->cur_pos[-2] == 0x00 &&
+            buf->cur_pos[-1] == 0x00 && buf->cur_pos[0] == 0x03)
+          buf->cur_pos++;
+      }
+      return bits;
+    }
+    else {
+      bits |= (*buf->cur_pos & i_mask[buf->cur_offset]) << -i_shr;
+      len -= buf->cur_offset;
+      buf->cur_pos++;
+      buf->cur_offset = 8;
+      if(buf->cur_pos - buf->buf > 2 && buf->cur_pos[-2] == 0x00 &&
+          buf->cur_pos[-1] == 0x00 && buf->cur_pos[0] == 0x03)
+        buf->cur_pos++;
+    }
+  }
+  return bits;
+}
+
+static uint32_t legacy_read_exp_golomb(struct buf_reader *buf)
+{
+  int leading_zero_bits = 0;
+
+  while (legacy_read_rbsp_bits(buf, 1) == 0 && leading_zero_bits < 32)
+    leading_zero_bits++;
+
+  return (1 << leading_zero_bits) - 1 +
+      legacy_read_rbsp_bits(buf, leading_zero_bits);
+}
+
+static int32_t legacy_read_exp_golomb_s(struct buf_reader *buf)
+{
+  uint32_t ue = legacy_read_exp_golomb(buf);
+  return ue & 0x01 ? (ue + 1) / 2 : -(ue / 2);
+}
+
+/* the Exp-Golomb coded fields of a P slice header of a 1080p stream:
+ * first_mb_in_slice, slice_type, pic_parameter_set_id, idr_pic_id,
+ * slice_qp_delta, disable_deblocking_filter_idc, slice_alpha_c0_offset,
+ * slice_beta_offset, with a 16 bit frame_num/poc_lsb word in between */
+#define GOLOMB_FIELDS  8
+#define GOLOMB_HEADERS (64 * 1024)
+#define GOLOMB_PASSES  32
+
+static const int golomb_signed[GOLOMB_FIELDS] = { 0, 0, 0, 0, 1, 0, 1, 1 };
+
+static void golomb_values(int32_t *v, uint32_t *seed)
+{
+  v[0] = bench_random(seed) % 8160;
+  v[1] = bench_random(seed) % 10;
+  v[2] = bench_random(seed) % 4;
+  v[3] = bench_random(seed) % 65536;
+  v[4] = (int32_t)(bench_random(seed) % 51) - 25;
+  v[5] = bench_random(seed) % 3;
+  v[6] = (int32_t)(bench_random(seed) % 13) - 6;
+  v[7] = (int32_t)(bench_random(seed) % 13) - 6;
+}
+
+static int bench_golomb(xine_t *xine)
+{
+  int rbsp_size = GOLOMB_HEADERS * 16;
+  uint8_t *rbsp = malloc(rbsp_size);
+  uint8_t *nal = malloc(rbsp_size * 3 / 2);
+  struct bit_writer bw;
+  struct buf_reader buf;
+  int32_t v[GOLOMB_FIELDS];
+  uint32_t seed = 1, legacy_sum = 0, sum = 0, check_sum = 0, poc;
+  double start, legacy_seconds, seconds;
+  int i, f, pass, len, escaped, failed = 0;
+
+  bit_writer_init(&bw, rbsp, rbsp_size);
+  for(i = 0; i < GOLOMB_HEADERS; i++) {
+    golomb_values(v, &seed);
+    for(f = 0; f < GOLOMB_FIELDS; f++) {
+      if(golomb_signed[f])
+        put_se(&bw, v[f]);
+      else
+        put_ue(&bw, v[f]);
+      check_sum += v[f];
+      /* frame_num and pic_order_cnt_lsb, zero on every 16th header to
+       * get 00 00 0x runs which need emulation prevention */
+      if(f == 2)
+        put_bits(&bw, i % 16 ? bench_random(&seed) >> 16 : 0, 16);
+    }
+  }
+  len = put_trailing_bits(&bw);
+  escaped = nal_escape(nal, rbsp, len);
+
+  /* the escaped stream decodes to the written values */
+  seed = 1;
+  buf.buf = buf.cur_pos = nal;
+  buf.len = escaped;
+  buf.cur_offset = 8;
+  for(i = 0; i < GOLOMB_HEADERS && !failed; i++) {
+    golomb_values(v, &seed);
+    for(f = 0; f < GOLOMB_FIELDS; f++) {
+      int32_t legacy_val, val;
+      struct buf_reader legacy_buf = buf;
+
+      legacy_val = golomb_signed[f] ? legacy_read_exp_golomb_s(&legacy_buf) :
+          (int32_t)legacy_read_exp_golomb(&legacy_buf);
+      val = golomb_signed[f] ? read_exp_golomb_s(&buf) :
+          (int32_t)read_exp_golomb(&buf);
+      if(val != v[f] || legacy_val != v[f] || legacy_buf.cur_pos != buf.cur_pos ||
+          legacy_buf.cur_offset != buf.cur_offset) {
+        printf("FAILED: header %d field %d wrote %d, read %d (byte loop %d)\n",
+            i, f, v[f], val, legacy_val);
+        failed = 1;
+        break;
+      }
+      if(f == 2) {
+        poc = legacy_read_rbsp_bits(&buf, 16);
+        if(!(i % 16) && poc) {
+          printf("FAILED: header %d frame_num/poc %04x\n", i, poc);
+          failed = 1;
+        }
+        else if(i % 16)
+          bench_random(&seed);
+      }
+    }
+  }
+
+  start = now();
+  for(pass = 0; pass < GOLOMB_PASSES; pass++) {
+    buf.buf = buf.cur_pos = nal;
+    buf.len = escaped;
+    buf.cur_offset = 8;
+    for(i = 0; i < GOLOMB_HEADERS; i++) {
+      for(f = 0; f < GOLOMB_FIELDS; f++) {
+        legacy_sum += golomb_signed[f] ? (uint32_t)legacy_read_exp_golomb_s(&buf) :
+            legacy_read_exp_golomb(&buf);
+        if(f == 2)
+          legacy_read_rbsp_bits(&buf, 16);
+      }
+    }
+  }
+  legacy_seconds = now() - start;
+
+  start = now();
+  for(pass = 0; pass < GOLOMB_PASSES; pass++) {
+    buf.buf = buf.cur_pos = nal;
+    buf.len = escaped;
+    buf.cur_offset = 8;
+    for(i = 0; i < GOLOMB_HEADERS; i++) {
+      for(f = 0; f < GOLOMB_FIELDS; f++) {
+        sum += golomb_signed[f] ? (uint32_t)read_exp_golomb_s(&buf) :
+            read_exp_golomb(&buf);
+        if(f == 2)
+          legacy_read_rbsp_bits(&buf, 16);
+      }
+    }
+  }
+  seconds = now() - start;
+
+  printf("golomb          %d slice headers of %d Exp-Golomb fields, %d bytes, "
+      "%d emulation prevention bytes\n", GOLOMB_HEADERS, GOLOMB_FIELDS, escaped,
+      escaped - len);
+  printf("bit loop        %.2f M headers/s\n",
+      GOLOMB_HEADERS * GOLOMB_PASSES / legacy_seconds / 1e6);
+  printf("clz             %.2f M headers/s (%.2fx)\n",
+      GOLOMB_HEADERS * GOLOMB_PASSES / seconds / 1e6, legacy_seconds / seconds);
+
+  free(rbsp);
+  free(nal);
+
+  if(!failed && (sum != legacy_sum || sum != check_sum * GOLOMB_PASSES)) {
+    printf("FAILED: sum %08x, byte loop %08x, written %08x\n", sum, legacy_sum,
+        check_sum * GOLOMB_PASSES);
+    failed = 1;
+  }
+  if(failed)
+    return 1;
+  printf("both decoders returned the written values\n");
+  return 0;
+}
+
+/*
+ * startcode
+ */
+
+#define SCAN_ALIGNS     64
+#define SCAN_MAX_LEN    160
+#define SCAN_SIZE       (16 * 1024 * 1024)
+#define SCAN_PASSES     8
+
+/* the bytes around a start code which kernels may get wrong */
+static const uint8_t scan_patterns[][4] = {
+  { 0x00, 0x00, 0x01, 0xff },   /* start code */
+  { 0x00, 0x00, 0x00, 0x01 },   /* with a leading zero byte */
+  { 0x00, 0x00, 0x02, 0xff },   /* near misses */
+  { 0x00, 0x01, 0x00, 0x00 },
+  { 0x00, 0x00, 0x03, 0x01 },   /* emulation prevention */
+};
+#define SCAN_PATTERNS (int)(sizeof(scan_patterns) / sizeof(scan_patterns[0]))
+
+/* runs kernel k on buf[0..len) and compares it with the byte loop */
+static int scan_check(start_code_func *kernels, const uint8_t *buf, int len,
+    const char *what, int align, int pos)
+{
+  int k, expect = kernels[START_CODE_BYTES](buf, len);
+
+  for(k = START_CODE_WORD; k < START_CODE_KERNELS; k++) {
+    int ret;
+
+    if(!kernels[k])
+      continue;
+    ret = kernels[k](buf, len);
+    if(ret != expect) {
+      printf("FAILED: %s kernel returned %d instead of %d, %s at %d, "
+          "alignment %d, length %d\n", find_start_code_kernel_name(k), ret,
+          expect, what, pos, align, len);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int bench_startcode(xine_t *xine)
+{
+  start_code_func kernels[START_CODE_KERNELS];
+  uint8_t *area = malloc(SCAN_ALIGNS + SCAN_MAX_LEN + 64);
+  uint8_t *data = malloc(SCAN_SIZE);
+  uint8_t *rbsp = malloc(SCAN_SIZE / 2);
+  uint32_t seed = 1;
+  double start, seconds, bytes_seconds = 0;
+  int k, align, len, pos, pat, pass, checks = 0, data_len, ret;
+
+  for(k = 0; k < START_CODE_KERNELS; k++)
+    kernels[k] = find_start_code_kernel(k);
+
+  /* every kernel, every buffer alignment, every length up to a few
+   * vectors and every position of each pattern, up to the ones cut off
+   * by the end of the buffer */
+  for(align = 0; align < SCAN_ALIGNS; align++) {
+    uint8_t *buf = area + align;
+
+    for(len = 0; len <= SCAN_MAX_LEN; len++) {
+      memset(area, 0xff, SCAN_ALIGNS + SCAN_MAX_LEN + 64);
+      if(scan_check(kernels, buf, len, "no start code", align, -1))
+        goto failed;
+      checks++;
+
+      for(pat = 0; pat < SCAN_PATTERNS; pat++) {
+        for(pos = 0; pos < len; pos++) {
+          int n = len - pos < 4 ? len - pos : 4;
+
+          memset(buf, 0xff, len);
+          memcpy(buf + pos, scan_patterns[pat], n);
+          /* a start code just beyond the end is not one */
+          memcpy(buf + len, scan_patterns[0], 3);
+          if(scan_check(kernels, buf, len, "pattern", align, pos))
+            goto failed;
+          checks++;
+        }
+      }
+
+      /* zero heavy random data, several start codes per buffer */
+      for(pass = 0; pass < 4; pass++) {
+        for(pos = 0; pos < len; pos++)
+          buf[pos] = bench_random(&seed) % 3 ? 0 : bench_random(&seed) >> 30;
+        if(scan_check(kernels, buf, len, "random", align, 0))
+          goto failed;
+        checks++;
+      }
+    }
+  }
+  printf("startcode       %d checks of each kernel at %d alignments and lengths "
+      "0 to %d passed\n", checks, SCAN_ALIGNS, SCAN_MAX_LEN);
+
+  /* slice data: random bytes escaped like a nal, so no start code in it
+   * and every kernel scans the whole buffer */
+  fill_random(rbsp, SCAN_SIZE / 2, 1);
+  data_len = nal_escape(data, rbsp, SCAN_SIZE / 2);
+
+  for(k = 0; k < START_CODE_KERNELS; k++) {
+    if(!kernels[k]) {
+      printf("%-15s not supported\n", find_start_code_kernel_name(k));
+      continue;
+    }
+    start = now();
+    for(pass = 0; pass < SCAN_PASSES; pass++) {
+      ret = kernels[k](data, data_len);
+      if(ret >= 0) {
+        printf("FAILED: %s kernel found a start code at %d in escaped data\n",
+            find_start_code_kernel_name(k), ret);
+        goto failed;
+      }
+    }
+    seconds = now() - start;
+    if(k == START_CODE_BYTES)
+      bytes_seconds = seconds;
+    printf("%-15s %.2f GB/s (%.2fx)\n", find_start_code_kernel_name(k),
+        (double)data_len * SCAN_PASSES / seconds / 1e9, bytes_seconds / seconds);
+  }
+
+  free(area);
+  free(data);
+  free(rbsp);
+  return 0;
+
+failed:
+  free(area);
+  free(data);
+  free(rbsp);
+  return 1;
+}
+
+/*
+ * scan
+ */
+
+#define SCAN_IDR_SIZE   (1024 * 1024)
+#define SCAN_CHUNK      2048
+#define SCAN_PICTURES   16
+
+static int bench_scan(xine_t *xine)
+{
+  struct h264_parser *parser = init_parser(xine);
+  struct h264_parser_stats stats;
+  struct h264_stream s;
+  uint32_t max_au_len = 0;
+  uint64_t scan_max;
+  double start, seconds;
+  int i, aus;
+
+  /* each idr picture is an access unit on its own, the end of sequence
+   * nal after the last one ends the stream on a start code */
+  h264_stream_init(&s, SCAN_PICTURES * SCAN_IDR_SIZE * 3 / 2);
+  for(i = 0; i < SCAN_PICTURES; i++) {
+    h264_stream_aud(&s);
+    if(!i) {
+      h264_stream_sps(&s, 40);
+      h264_stream_pps(&s, 0, 26);
+    }
+    h264_stream_picture(&s, 1, 0, 0, SCAN_IDR_SIZE, 1);
+  }
+  h264_stream_end_of_seq(&s);
+
+  start = now();
+  aus = h264_stream_parse(parser, &s, SCAN_CHUNK, &max_au_len);
+  seconds = now() - start;
+  stats = parser->stats;
+  /* a search fails at most once per chunk, and searches its last two
+   * bytes again with the next one */
+  scan_max = stats.bytes_received + 2 * ((s.len + SCAN_CHUNK - 1) / SCAN_CHUNK);
+
+  printf("scan            %d IDR pictures of %d kB slice data in %d byte chunks\n",
+      SCAN_PICTURES, SCAN_IDR_SIZE / 1024, SCAN_CHUNK);
+  printf("access units    %d, largest %u bytes\n", aus, max_au_len);
+  printf("received        %llu bytes, scanned %llu bytes, at most %llu, %.0f MB/s\n",
+      (unsigned long long)stats.bytes_received,
+      (unsigned long long)stats.bytes_scanned, (unsigned long long)scan_max,
+      s.len / seconds / 1e6);
+
+  free(s.buf);
+  free_parser(parser);
+
+  if(stats.bytes_scanned > scan_max || aus < SCAN_PICTURES - 1 ||
+      max_au_len < SCAN_IDR_SIZE) {
+    printf("FAILED: every byte received has to be scanned once\n");
+    return 1;
+  }
+  printf("every byte received was scanned once, and the ends of the chunks twice\n");
+  return 0;
+}
+
+/*
+ * bigidr
+ */
+
+#define BIGIDR_PICTURES 6
+#define BIGIDR_SLICES   4
+#define BIGIDR_SLICE    (768 * 1024)
+
+static int bigidr_parse(xine_t *xine, const struct h264_stream *s, int chunk,
+    const int *begin, const int *end)
+{
+  struct h264_parser *parser = init_parser(xine);
+  uint8_t *ret_buf;
+  uint32_t ret_len;
+  struct coded_picture *ret_pic;
+  int pos = 0, len, aus = 0, intact = 0;
+
+  do {
+    len = s->len - pos < chunk ? s->len - pos : chunk;
+    pos += parse_frame(parser, s->buf + pos, len, 0, &ret_buf, &ret_len, &ret_pic);
+    if(ret_buf) {
+      /* the access unit ends with the slices of the picture */
+      uint32_t slices_len = end[aus] - begin[aus];
+
+      if(aus < BIGIDR_PICTURES && ret_len >= slices_len &&
+          !memcmp(ret_buf + ret_len - slices_len, s->buf + begin[aus], slices_len))
+        intact++;
+      aus++;
+    }
+    if(ret_pic)
+      free_coded_picture(ret_pic);
+  } while(pos < s->len || ret_buf);
+
+  printf("%4d byte chunks %d of %d access units intact, buffers grew %u times "
+      "up to %u bytes\n", chunk, intact, BIGIDR_PICTURES, parser->stats.buf_grows,
+      parser->stats.buf_peak_size);
+
+  free_parser(parser);
+  return intact == BIGIDR_PICTURES && aus == BIGIDR_PICTURES ? 0 : 1;
+}
+
+static int bench_bigidr(xine_t *xine)
+{
+  struct h264_stream s;
+  int begin[BIGIDR_PICTURES], end[BIGIDR_PICTURES];
+  int i, failed;
+
+  /* level 4.0 main profile allows access units of up to 3.75 MB, three
+   * times the limit the parser has until it sees the sps */
+  h264_stream_init(&s, BIGIDR_PICTURES * BIGIDR_SLICES * BIGIDR_SLICE * 3 / 2);
+  for(i = 0; i < BIGIDR_PICTURES; i++) {
+    h264_stream_aud(&s);
+    if(!i) {
+      h264_stream_sps(&s, 40);
+      h264_stream_pps(&s, 0, 26);
+    }
+    begin[i] = s.len;
+    h264_stream_picture(&s, 1, 0, 0, BIGIDR_SLICE, BIGIDR_SLICES);
+    end[i] = s.len;
+  }
+  h264_stream_aud(&s);
+  h264_stream_end_of_seq(&s);
+
+  printf("bigidr          %d IDR pictures of %d slices, %d kB each\n",
+      BIGIDR_PICTURES, BIGIDR_SLICES, (end[0] - begin[0]) / 1024);
+  failed = bigidr_parse(xine, &s, 188, begin, end);
+  failed |= bigidr_parse(xine, &s, 2048, begin, end);
+
+  free(s.buf);
+
+  if(failed) {
+    printf("FAILED: access units were lost or damaged\n");
+    return 1;
+  }
+  printf("every access unit came out intact\n");
+  return 0;
+}
+
+/*
+ * avcc
+ */
+
+#define AVCC_PICTURES   60
+#define AVCC_GOP        30
+#define AVCC_MAX_AUS    AVCC_PICTURES
+
+/* rewrites the annex b stream s with size_length byte nal sizes, the
+ * first sps and pps go into the avcC codec private data like in mp4,
+ * repeated ones stay in the stream */
+static int h264_stream_to_avcc(const struct h264_stream *s, struct h264_stream *out,
+    int size_length, uint8_t *avcc)
+{
+  int pos, next, len, i, avcc_len = 6, have_sps = 0, have_pps = 0;
+
+  h264_stream_init(out, s->size);
+  avcc[0] = 1;
+  avcc[4] = 0xfc | (size_length - 1);
+  avcc[5] = 0xe0;
+
+  for(pos = find_start_code(s->buf, s->len); pos >= 0; pos = next) {
+    uint8_t *nal = s->buf + pos + 3;
+    int type = nal[0] & 0x1f;
+
+    next = find_start_code(nal, s->buf + s->len - nal);
+    len = next < 0 ? s->buf + s->len - nal : next;
+    if(next >= 0)
+      next += pos + 3;
+
+    if((type == NAL_SPS && !have_sps) || (type == NAL_PPS && have_sps && !have_pps)) {
+      if(type == NAL_SPS) {
+        /* profile, compatibility and level */
+        memcpy(avcc + 1, nal + 1, 3);
+        avcc[5] |= 1;
+        have_sps = 1;
+      } else {
+        avcc[avcc_len++] = 1;
+        have_pps = 1;
+      }
+      avcc[avcc_len++] = len >> 8;
+      avcc[avcc_len++] = len;
+      memcpy(avcc + avcc_len, nal, len);
+      avcc_len += len;
+      continue;
+    }
+
+    for(i = size_length - 1; i >= 0; i--)
+      out->buf[out->len++] = len >> (i * 8);
+    memcpy(out->buf + out->len, nal, len);
+    out->len += len;
+  }
+  return avcc_len;
+}
+
+/* copies an access unit without its start codes, 3 and 4 byte start
+ * codes are used in different places */
+static int au_strip(uint8_t *dst, const uint8_t *au, int len)
+{
+  int i, n = 0;
+
+  for(i = 0; i < len; i++) {
+    if(i + 2 < len && !au[i] && !au[i + 1] && au[i + 2] == 1) {
+      /* the zero byte of a 4 byte start code, a nal never ends on zero */
+      if(n && !dst[n - 1])
+        n--;
+      i += 2;
+      continue;
+    }
+    dst[n++] = au[i];
+  }
+  return n;
+}
+
+struct avcc_aus {
+  uint8_t *buf;
+  int offset[AVCC_MAX_AUS + 1];
+  int count;
+};
+
+/* feeds the stream, and the codec private data if there is one, to a
+ * new parser and collects the access units without their start codes.
+ * bytes_copied is what the parser copied of the stream, the parameter
+ * set structs it copies per picture are not counted */
+static double avcc_parse(xine_t *xine, const struct h264_stream *s,
+    uint8_t *avcc, int avcc_len, int chunk, struct avcc_aus *aus,
+    uint64_t *bytes_copied)
+{
+  struct h264_parser *parser = init_parser(xine);
+  uint8_t *ret_buf;
+  uint32_t ret_len;
+  struct coded_picture *ret_pic;
+  int pos = 0, len;
+  double start;
+
+  set_parser_max_buf_size(parser, MAX_BUF_SIZE);
+  aus->count = 0;
+  aus->offset[0] = 0;
+
+  start = now();
+  if(avcc)
+    parse_codec_private(parser, avcc, avcc_len);
+  do {
+    len = s->len - pos < chunk ? s->len - pos : chunk;
+    pos += parse_frame(parser, s->buf + pos, len, 0, &ret_buf, &ret_len, &ret_pic);
+    if(ret_buf && aus->count < AVCC_MAX_AUS) {
+      aus->offset[aus->count + 1] = aus->offset[aus->count] +
+          au_strip(aus->buf + aus->offset[aus->count], ret_buf, ret_len);
+      aus->count++;
+    }
+    if(ret_pic)
+      free_coded_picture(ret_pic);
+  } while(pos < s->len || ret_buf);
+  start = now() - start;
+
+  /* the parser counts the bytes it copies into the access unit buffers,
+   * without the in place path every byte received went to prebuf first */
+  *bytes_copied = parser->stats.bytes_copied;
+  if(parser->nal_size_length != 4)
+    *bytes_copied += parser->stats.bytes_received + parser->stats.bytes_moved;
+  free_parser(parser);
+  return start;
+}
+
+static int avcc_same(const struct avcc_aus *a, const struct avcc_aus *b)
+{
+  int i;
+
+  if(a->count != b->count)
+    return 0;
+  for(i = 0; i < a->count; i++) {
+    int len = a->offset[i + 1] - a->offset[i];
+
+    if(len != b->offset[i + 1] - b->offset[i] ||
+        memcmp(a->buf + a->offset[i], b->buf + b->offset[i], len))
+      return 0;
+  }
+  return 1;
+}
+
+static int bench_avcc(xine_t *xine)
+{
+  static const int chunks[] = { 7, 188, 2048, 8192 };
+  static const int size_lengths[] = { 4, 2 };
+  struct h264_stream s, avcc_stream;
+  struct avcc_aus ref, aus;
+  uint8_t avcc[256];
+  uint64_t bytes_copied;
+  double seconds;
+  int i, c, l, avcc_len, failed = 0;
+
+  /* slices stay below 64 kB, so 2 byte nal sizes can carry them */
+  h264_stream_init(&s, 4 * 1024 * 1024);
+  h264_stream_sps(&s, 40);
+  h264_stream_pps(&s, 0, 26);
+  for(i = 0; i < AVCC_PICTURES; i++) {
+    if(i % AVCC_GOP)
+      h264_stream_picture(&s, 0, i % AVCC_GOP, 0, 16 * 1024, 2);
+    else
+      h264_stream_picture(&s, 1, 0, 0, 48 * 1024, 8);
+  }
+
+  ref.buf = malloc(s.len);
+  aus.buf = malloc(s.len);
+
+  seconds = avcc_parse(xine, &s, NULL, 0, 8192, &ref, &bytes_copied);
+  printf("avcc            %d pictures, %d access units complete\n", AVCC_PICTURES,
+      ref.count);
+  printf("annex b         %4.0f MB/s, %.3f bytes copied per byte\n",
+      s.len / seconds / 1e6, (double)bytes_copied / s.len);
+  if(ref.count != AVCC_PICTURES - 1) {
+    printf("FAILED: annex b gave %d access units instead of %d\n", ref.count,
+        AVCC_PICTURES - 1);
+    failed = 1;
+  }
+
+  for(l = 0; l < 2 && !failed; l++) {
+    avcc_len = h264_stream_to_avcc(&s, &avcc_stream, size_lengths[l], avcc);
+    for(c = 0; c < 4; c++) {
+      seconds = avcc_parse(xine, &avcc_stream, avcc, avcc_len, chunks[c], &aus,
+          &bytes_copied);
+      if(!avcc_same(&ref, &aus)) {
+        printf("FAILED: %d byte nal sizes in %d byte chunks gave other access "
+            "units than annex b\n", size_lengths[l], chunks[c]);
+        failed = 1;
+      }
+      if(size_lengths[l] == 4 && bytes_copied > (uint64_t)avcc_stream.len) {
+        printf("FAILED: %.2f bytes copied per byte in %d byte chunks, the in "
+            "place path copies at most once\n",
+            (double)bytes_copied / avcc_stream.len, chunks[c]);
+        failed = 1;
+      }
+    }
+    /* the last run used the largest chunks */
+    printf("%d byte sizes    %4.0f MB/s, %.3f bytes copied per byte, %s\n",
+        size_lengths[l], avcc_stream.len / seconds / 1e6,
+        (double)bytes_copied / avcc_stream.len,
+        size_lengths[l] == 4 ? "in place" : "through prebuf");
+    free(avcc_stream.buf);
+  }
+
+  free(ref.buf);
+  free(aus.buf);
+  free(s.buf);
+
+  if(failed)
+    return 1;
+  printf("every chunk size gave the annex b access units, in place with at "
+      "most one copy\n");
+  return 0;
+}
+
+/*
+ * pps
+ */
+
+#define PPS_PICTURES    20000
+
+/* qp of the pps with id pps_id sent before picture i */
+static int pps_qp(int i, int pps_id, int changing)
+{
+  return 20 + pps_id * 8 + (changing ? i % 8 : 0);
+}
+
+static int pps_parse(xine_t *xine, int changing, double *seconds,
+    uint32_t *repeated)
+{
+  struct h264_parser *parser = init_parser(xine);
+  struct h264_stream s;
+  uint8_t *ret_buf;
+  uint32_t ret_len;
+  struct coded_picture *ret_pic;
+  int i, pos = 0, len, aus = 0, wrong = 0;
+  double start;
+
+  /* small P pictures, most of the time goes to the headers */
+  h264_stream_init(&s, PPS_PICTURES * 512);
+  h264_stream_sps(&s, 40);
+  for(i = 0; i < PPS_PICTURES; i++) {
+    h264_stream_aud(&s);
+    h264_stream_pps(&s, 0, pps_qp(i, 0, changing));
+    h264_stream_pps(&s, 1, pps_qp(i, 1, changing));
+    h264_stream_picture(&s, !i, i % 16, i % 2, 128, 1);
+  }
+  h264_stream_aud(&s);
+  h264_stream_end_of_seq(&s);
+
+  set_parser_slice_parse_mode(parser, SLICE_PARSE_FULL);
+  start = now();
+  do {
+    len = s.len - pos < 4096 ? s.len - pos : 4096;
+    pos += parse_frame(parser, s.buf + pos, len, 0, &ret_buf, &ret_len, &ret_pic);
+    if(ret_pic) {
+      /* the picture has to refer to the pps it was sent with */
+      struct pic_parameter_set_rbsp *pps = ret_pic->pps_nal ? ret_pic->pps_nal->pps : NULL;
+
+      if(!pps || pps->pic_parameter_set_id != aus % 2 ||
+          pps->pic_init_qp_minus26 + 26 != pps_qp(aus, aus % 2, changing))
+        wrong++;
+      aus++;
+      free_coded_picture(ret_pic);
+    }
+  } while(pos < s.len || ret_buf);
+  *seconds = now() - start;
+  *repeated = parser->stats.param_sets_repeated;
+
+  free_parser(parser);
+  free(s.buf);
+
+  if(aus != PPS_PICTURES || wrong) {
+    printf("FAILED: %d pictures, %d of them with the wrong pps\n", aus, wrong);
+    return 1;
+  }
+  return 0;
+}
+
+static int bench_pps(xine_t *xine)
+{
+  double seconds, changing_seconds;
+  uint32_t repeated, changing_repeated;
+
+  if(pps_parse(xine, 0, &seconds, &repeated) ||
+      pps_parse(xine, 1, &changing_seconds, &changing_repeated))
+    return 1;
+
+  printf("pps             %d pictures, pps 0 and 1 sent before each, slices "
+      "alternate between them\n", PPS_PICTURES);
+  printf("repeated pps    %.0f k pictures/s, %u pps taken as repeated\n",
+      PPS_PICTURES / seconds / 1e3, repeated);
+  printf("changing pps    %.0f k pictures/s, %u pps taken as repeated (%.2fx)\n",
+      PPS_PICTURES / changing_seconds / 1e3, changing_repeated,
+      changing_seconds / seconds);
+
+  /* every pps but the first two is sent unchanged, or with an other qp */
+  if(repeated != 2 * (PPS_PICTURES - 1) || changing_repeated) {
+    printf("FAILED: %u repeated pps expected\n", 2 * (PPS_PICTURES - 1));
+    return 1;
+  }
+  printf("every picture found the pps it was sent with\n");
+  return 0;
+}
+
+/*
+ * alloc
+ */
+
+#define ALLOC_GOPS      8
+#define ALLOC_GOP       25
+/* the access unit buffers take turns, each grows to the size of an idr
+ * picture the first time it gets one */
+#define ALLOC_WARM_UP   (2 * ALLOC_GOP)
+
+static int alloc_parse(xine_t *xine, const struct h264_stream *s, uint8_t *avcc,
+    int avcc_len, enum slice_parse_mode mode, const char *name)
+{
+  struct h264_parser *parser = init_parser(xine);
+  uint8_t *ret_buf;
+  uint32_t ret_len;
+  struct coded_picture *ret_pic;
+  uint64_t allocations = 0;
+  int pos = 0, len, aus = 0;
+
+  set_parser_slice_parse_mode(parser, mode);
+  if(avcc)
+    parse_codec_private(parser, avcc, avcc_len);
+  do {
+    len = s->len - pos < 4096 ? s->len - pos : 4096;
+    pos += parse_frame(parser, s->buf + pos, len, 0, &ret_buf, &ret_len, &ret_pic);
+    if(ret_pic)
+      free_coded_picture(ret_pic);
+    /* the first two gops grow the buffers and fill the pools */
+    if(ret_buf && ++aus == ALLOC_WARM_UP)
+      allocations = bench_allocations();
+  } while(pos < s->len || ret_buf);
+  allocations = bench_allocations() - allocations;
+
+  printf("%-15s %.2f allocations per access unit after the first %d of %d, "
+      "%d nal units and %d pictures in the pools\n", name,
+      (double)allocations / (aus - ALLOC_WARM_UP), ALLOC_WARM_UP, aus,
+      parser->nal_pool->allocated, parser->pic_pool->allocated);
+
+  free_parser(parser);
+
+  if(aus != ALLOC_GOPS * ALLOC_GOP - 1 || allocations) {
+    printf("FAILED: %d access units, %llu allocations after warm-up\n", aus,
+        (unsigned long long)allocations);
+    return 1;
+  }
+  return 0;
+}
+
+static int bench_alloc(xine_t *xine)
+{
+  struct h264_stream s, avcc_stream;
+  uint8_t avcc[256];
+  int i, avcc_len, failed;
+
+  /* the parameter sets are repeated with every IDR picture, like
+   * broadcast streams do */
+  h264_stream_init(&s, 4 * 1024 * 1024);
+  for(i = 0; i < ALLOC_GOPS * ALLOC_GOP; i++) {
+    if(i % ALLOC_GOP) {
+      h264_stream_picture(&s, 0, i % ALLOC_GOP, 0, 4 * 1024, 2);
+    } else {
+      h264_stream_sps(&s, 40);
+      h264_stream_pps(&s, 0, 26);
+      h264_stream_picture(&s, 1, 0, 0, 32 * 1024, 4);
+    }
+  }
+  avcc_len = h264_stream_to_avcc(&s, &avcc_stream, 4, avcc);
+
+  printf("alloc           %d gops of %d pictures\n", ALLOC_GOPS, ALLOC_GOP);
+  failed = alloc_parse(xine, &s, NULL, 0, SLICE_PARSE_BOUNDARY, "annex b");
+  failed |= alloc_parse(xine, &s, NULL, 0, SLICE_PARSE_FULL, "annex b full");
+  failed |= alloc_parse(xine, &avcc_stream, avcc, avcc_len, SLICE_PARSE_BOUNDARY, "avcc");
+  failed |= alloc_parse(xine, &avcc_stream, avcc, avcc_len, SLICE_PARSE_FULL, "avcc full");
+
+  free(avcc_stream.buf);
+  free(s.buf);
+
+  if(failed)
+    return 1;
+  printf("no allocations per access unit after warm-up\n");
+  return 0;
+}
+
+/*
+ * seek
+ */
+
+#define SEEK_LOOPS      2000
+#define SEEK_CHUNK      4096
+
+/* one gop from the keyframe the demuxer seeks to, the AUD at the end
+ * completes the last picture once the start code behind it is found */
+static void seek_stream(struct h264_stream *s)
+{
+  int i;
+
+  h264_stream_init(s, 512 * 1024);
+  h264_stream_aud(s);
+  h264_stream_sps(s, 40);
+  h264_stream_pps(s, 0, 26);
+  h264_stream_picture(s, 1, 0, 0, 128 * 1024, 1);
+  for(i = 1; i < 8; i++) {
+    h264_stream_aud(s);
+    h264_stream_picture(s, 0, i, 0, 16 * 1024, 1);
+  }
+  h264_stream_aud(s);
+  h264_stream_end_of_seq(s);
+}
+
+static int bench_seek(xine_t *xine)
+{
+  struct h264_parser *parser;
+  struct h264_stream s;
+  uint64_t allocations, recreate_allocations, reset_allocations;
+  double start, recreate_seconds, reset_seconds;
+  int i, aus, failed = 0;
+
+  seek_stream(&s);
+
+  /* the way crystalhd_video_reset used to do it */
+  parser = init_parser(xine);
+  set_parser_max_buf_size(parser, MAX_BUF_SIZE);
+  h264_stream_parse(parser, &s, SEEK_CHUNK, NULL);
+  allocations = bench_allocations();
+  start = now();
+  for(i = 0; i < SEEK_LOOPS; i++) {
+    free_parser(parser);
+    parser = init_parser(xine);
+    set_parser_max_buf_size(parser, MAX_BUF_SIZE);
+    aus = h264_stream_parse(parser, &s, SEEK_CHUNK, NULL);
+    if(aus != 8 && !failed) {
+      printf("FAILED: %d access units after a seek instead of 8\n", aus);
+      failed = 1;
+    }
+  }
+  recreate_seconds = now() - start;
+  recreate_allocations = bench_allocations() - allocations;
+  free_parser(parser);
+
+  /* the way it does it now */
+  parser = init_parser(xine);
+  set_parser_max_buf_size(parser, MAX_BUF_SIZE);
+  h264_stream_parse(parser, &s, SEEK_CHUNK, NULL);
+  allocations = bench_allocations();
+  start = now();
+  for(i = 0; i < SEEK_LOOPS; i++) {
+    reset_parser(parser);
+    aus = h264_stream_parse(parser, &s, SEEK_CHUNK, NULL);
+    if(aus != 8 && !failed) {
+      printf("FAILED: %d access units after a seek instead of 8\n", aus);
+      failed = 1;
+    }
+  }
+  reset_seconds = now() - start;
+  reset_allocations = bench_allocations() - allocations;
+
+  printf("seek            %d seeks, each followed by one gop of 8 pictures, %d bytes\n",
+      SEEK_LOOPS, s.len);
+  printf("free/init       %.0f seeks/s, %.1f allocations per seek\n",
+      SEEK_LOOPS / recreate_seconds, (double)recreate_allocations / SEEK_LOOPS);
+  printf("reset_parser    %.0f seeks/s, %.1f allocations per seek (%.2fx), "
+      "parser memory %u bytes\n", SEEK_LOOPS / reset_seconds,
+      (double)reset_allocations / SEEK_LOOPS, recreate_seconds / reset_seconds,
+      parser_buf_memory(parser));
+
+  free_parser(parser);
+  free(s.buf);
+
+  if(failed)
+    return 1;
+  if(reset_allocations) {
+    printf("FAILED: reset_parser seeks allocate\n");
+    return 1;
+  }
+  printf("seeks with reset_parser allocate nothing\n");
+  return 0;
+}
+
+static const struct {
+  const char *name;
+  int (*run)(xine_t *xine);
+} benches[] = {
+  { "bits",      bench_bits },
+  { "golomb",    bench_golomb },
+  { "startcode", bench_startcode },
+  { "scan",      bench_scan },
+  { "bigidr",    bench_bigidr },
+  { "avcc",      bench_avcc },
+  { "pps",       bench_pps },
+  { "alloc",     bench_alloc },
+  { "seek",      bench_seek },
+};
+
+int bench_parser(xine_t *xine, const char *name)
+{
+  size_t i;
+
+  for(i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+    if(!strcmp(name, benches[i].name))
+      return benches[i].run(xine);
+  }
+
+  fprintf(stderr, "unknown benchmark %s, one of:", name);
+  for(i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+    fprintf(stderr, " %s", benches[i].name);
+  fprintf(stderr, "\n");
+  return 1;
+}
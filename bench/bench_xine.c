@@ -0,0 +1,97 @@
+/*
+ * bench_xine.c: stand-ins for the xine engine and for the parts of
+ * crystalhd_decoder.c which the parsers call, plus the allocation
+ * and copy counters of the crystalhd bench.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../crystalhd_decoder.h"
+#include "bench.h"
+
+struct bench_counters bench_counters;
+
+HANDLE hDevice = 0;
+
+static void *bench_memcpy(void *to, const void *from, size_t len)
+{
+  bench_counters.bytes_copied += len;
+  return memcpy(to, from, len);
+}
+
+void *(* xine_fast_memcpy)(void *to, const void *from, size_t len) = bench_memcpy;
+
+/* the bench is linked with --wrap for these, so every allocation of
+ * the code under test is counted */
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__real_valloc(size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+  bench_counters.mallocs++;
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+  bench_counters.callocs++;
+  return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+  bench_counters.reallocs++;
+  return __real_realloc(ptr, size);
+}
+
+void *__wrap_valloc(size_t size)
+{
+  bench_counters.vallocs++;
+  return __real_valloc(size);
+}
+
+/* the C version of xine's yuy2_to_yuy2, which the renderer used before
+ * crystalhd_copy_plane */
+void yuy2_to_yuy2(const unsigned char *src, int src_pitch,
+    unsigned char *dst, int dst_pitch, int width, int height)
+{
+  int i;
+
+  if(src_pitch == dst_pitch) {
+    xine_fast_memcpy(dst, src, src_pitch * height);
+    return;
+  }
+
+  for(i = 0; i < height; i++) {
+    xine_fast_memcpy(dst, src, width * 2);
+    dst += dst_pitch;
+    src += src_pitch;
+  }
+}
+
+void _x_stream_info_set(xine_stream_t *stream, int info, int value)
+{
+}
+
+void _x_meta_info_set_utf8(xine_stream_t *stream, int info, const char *str)
+{
+}
+
+void xine_event_send(xine_stream_t *stream, const xine_event_t *event)
+{
+}
+
+/* crystalhd_decoder.c also reports the format to xine here */
+void set_video_params (crystalhd_video_decoder_t *this)
+{
+  xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_bench: %dx%d video_step %d\n",
+      this->width, this->height, this->video_step);
+}
+
+/* only the receive thread of crystalhd_decoder.c uses the plane sizes */
+void crystalhd_video_set_picture_size (crystalhd_video_decoder_t *this)
+{
+}
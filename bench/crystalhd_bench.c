@@ -0,0 +1,1161 @@
+/*
+ * crystalhd_bench.c: feeds an elementary stream through the demux side
+ * of the crystalhd decoder, without xine and without the hardware, and
+ * reports the throughput of the parsers.
+ *
+ * With -o it instead runs the receive loop against stand-in hardware which
+ * makes a picture ready every 1/fps seconds, and reports the latency from
+ * ready to dequeued and how often the loop woke up.
+ *
+ * With -R it pushes pictures through the image ring from one thread to
+ * another, checks that every one arrives intact and in order, and reports
+ * the ring throughput.
+ *
+ * With -F the receive thread and the renderer are simulated with full size
+ * pictures: one thread writes every picture like the card does, the other
+ * copies it out like the renderer. It reports page faults and cpu time per
+ * picture, with the transfer buffers from malloc or from the frame pool,
+ * or with direct output, where the pooled buffer stands in for the vo frame
+ * the card writes into and the renderer copies nothing. -O yv12 has the
+ * card write NV12 and the renderer split it into the planes of a YV12
+ * frame, and the bytes moved per picture are reported for either format.
+ *
+ * With -S one picture is copied into a vo frame over and over by the
+ * renderer and 0 to n-1 stripe workers, and the time per picture is
+ * reported for every thread count.
+ *
+ * With -C YUY2 pictures of 720p and 1080p are copied into vo frames with
+ * and without padded lines, by xine's yuy2_to_yuy2 and in stripes by the
+ * renderer and its default workers through the cache and streamed past it,
+ * and the time per picture and which of the two the decoder picks are
+ * reported.
+ *
+ * With -B a parser microbenchmark of bench_parser.c runs by name.
+ *
+ * With -D the card and the renderer are simulated in 90 kHz ticks. The
+ * card finishes a picture every frame period, and the renderer either
+ * draws one picture per demuxer buffer like it used to, or draws what the
+ * render scheduler says is due, dropping pictures with the decimator while
+ * it falls behind if asked. Drawing can take a fixed time. The scheduler
+ * skips the copy of late pictures like the decoder does. It
+ * reports the backlog, the drops and skips and how many pictures were
+ * drawn after they should have been shown.
+ *
+ * usage: crystalhd_bench [options] file
+ *        crystalhd_bench -o fps [-t seconds] [-p poll|sched]
+ *        crystalhd_bench -R pictures
+ *        crystalhd_bench -F pictures [-w WxH] [-P malloc|pool|direct] [-H] [-O yuy2|yv12]
+ *        crystalhd_bench -S pictures [-w WxH] [-O yuy2|yv12] [-j threads]
+ *        crystalhd_bench -C pictures
+ *        crystalhd_bench -D fps [-b buffers] [-t seconds] [-m input|sched|decimate|late] [-d usec]
+ *        crystalhd_bench -B name
+ *   -f h264|avcc|vc1  stream format, default h264 (annex b)
+ *   -x file           avcC codec private data, needed for avcc
+ *   -c bytes          size of the buffers handed to the decoder, default 4096
+ *   -r runs           number of runs, the fastest one is reported, default 5
+ *   -s full|boundary  h264 slice header parse mode, default boundary
+ *   -q depth          h264 submit queue depth, 0 sends from the parser, default 8
+ *   -l usec           time the stand-in hardware takes per DtsProcInput, default 0
+ *   -v                log like the plugin does
+ *   -o fps            simulate the output side at that frame rate
+ *   -t seconds        length of the simulated stream, followed by one idle second, default 5
+ *   -p poll|sched     receive loop, the former 5 ms poll or the scheduler, default sched
+ *   -R pictures       image ring stress test and throughput
+ *   -F pictures       picture buffer simulation
+ *   -w WxH            picture size for -F, default 1920x1082
+ *   -P malloc|pool|direct  picture buffers for -F, default pool
+ *   -H                back the pool with transparent huge pages
+ *   -O yuy2|yv12      picture format for -F and -S, default yuy2
+ *   -S pictures       striped copy scaling
+ *   -j threads        most threads for -S, default the number of cpus
+ *   -C pictures       frame copy microbenchmark
+ *   -D fps            render pacing simulation at that frame rate
+ *   -b buffers        demuxer buffers per second for -D, default half the frame rate
+ *   -m input|sched|decimate|late  renderer for -D, one picture per buffer, the scheduler,
+ *                     the scheduler dropping pictures while it falls behind, or the
+ *                     decimator alone at level 1 with every picture late, default sched
+ *   -d usec           time the renderer takes per picture for -D, default 0
+ *   -B name           parser microbenchmark, see bench_parser.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/resource.h>
+
+#include "../crystalhd_decoder.h"
+#include "../crystalhd_h264.h"
+#include "../crystalhd_vc1.h"
+#include "../crystalhd_submit.h"
+#include "../crystalhd_ring.h"
+#include "../crystalhd_pool.h"
+#include "../crystalhd_render.h"
+#include "../crystalhd_decimate.h"
+#include "../crystalhd_copy.h"
+#include "../crystalhd_yuv.h"
+#include "../crystalhd_stripes.h"
+#include "bench.h"
+
+enum bench_format {
+  FORMAT_H264,
+  FORMAT_AVCC,
+  FORMAT_VC1
+};
+
+struct bench_run {
+  double seconds;
+  struct bench_counters counters;
+  struct h264_parser_stats parser_stats;
+  uint32_t parser_memory;
+  uint32_t nal_units;
+  uint32_t pictures;
+  struct submit_stats submit_stats;
+};
+
+static uint8_t *read_file(const char *name, long *len)
+{
+  FILE *f = fopen(name, "rb");
+  uint8_t *data;
+
+  if(!f) {
+    perror(name);
+    return NULL;
+  }
+
+  fseek(f, 0, SEEK_END);
+  *len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  data = malloc(*len > 0 ? *len : 1);
+  if(fread(data, 1, *len, f) != (size_t)*len) {
+    perror(name);
+    free(data);
+    data = NULL;
+  }
+
+  fclose(f);
+  return data;
+}
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* the parts of crystalhd_video_open_plugin which the demux side needs */
+static crystalhd_video_decoder_t *open_decoder(xine_t *xine,
+    enum slice_parse_mode slice_parse_mode, int submit_queue_depth)
+{
+  crystalhd_video_decoder_t *this = calloc(1, sizeof(crystalhd_video_decoder_t));
+
+  this->xine = xine;
+  this->h264_buffer_limit = MAX_BUF_SIZE / 1024;
+
+  this->sequence_vc1.bufsize = 10000;
+  this->sequence_vc1.buf = (uint8_t*)malloc(this->sequence_vc1.bufsize);
+  crystalhd_vc1_init_sequence( &this->sequence_vc1 );
+
+  this->nal_parser = init_parser(this->xine);
+  set_parser_max_buf_size(this->nal_parser, (size_t)this->h264_buffer_limit * 1024);
+  set_parser_slice_parse_mode(this->nal_parser, slice_parse_mode);
+
+  this->submit_queue_depth = submit_queue_depth;
+  if(this->submit_queue_depth > 0)
+    this->submit = crystalhd_submit_create(this, this->submit_queue_depth);
+
+  DtsDeviceOpen(&hDevice, 0);
+
+  return this;
+}
+
+static void close_decoder(crystalhd_video_decoder_t *this)
+{
+  if(this->submit)
+    crystalhd_submit_free(this->submit);
+
+  hDevice = crystalhd_stop(this, hDevice);
+  hDevice = crystalhd_close(this, hDevice);
+
+  free(this->sequence_vc1.bytestream);
+  free(this->sequence_vc1.buf);
+
+  crystalhd_h264_free_parser(this);
+  free(this->extradata);
+  free(this);
+}
+
+static void run(struct bench_run *result, xine_t *xine, enum bench_format format,
+    enum slice_parse_mode slice_parse_mode, int submit_queue_depth,
+    uint8_t *data, long len, uint8_t *codec_private, long codec_private_len,
+    int chunk)
+{
+  crystalhd_video_decoder_t *this;
+  buf_element_t buf;
+  long pos;
+  double start;
+
+  memset(&bench_counters, 0, sizeof(bench_counters));
+  start = now();
+
+  this = open_decoder(xine, slice_parse_mode, submit_queue_depth);
+
+  memset(&buf, 0, sizeof(buf));
+  buf.type = format == FORMAT_VC1 ? BUF_VIDEO_VC1 : BUF_VIDEO_H264;
+
+  if(format == FORMAT_AVCC) {
+    buf.decoder_flags = BUF_FLAG_SPECIAL;
+    buf.decoder_info[1] = BUF_SPECIAL_DECODER_CONFIG;
+    buf.decoder_info[2] = codec_private_len;
+    buf.decoder_info_ptr[2] = codec_private;
+    crystalhd_h264_decode_data(&this->video_decoder, &buf);
+  }
+
+  for(pos = 0; pos < len; pos += chunk) {
+    buf.content = data + pos;
+    buf.size = len - pos < chunk ? len - pos : chunk;
+    buf.decoder_flags = pos == 0 ? BUF_FLAG_FRAME_START : 0;
+
+    if(format == FORMAT_VC1)
+      crystalhd_vc1_decode_data(&this->video_decoder, &buf);
+    else
+      crystalhd_h264_decode_data(&this->video_decoder, &buf);
+  }
+
+  /* everything parsed has to reach the hardware before the clock stops */
+  memset(&result->submit_stats, 0, sizeof(result->submit_stats));
+  if(this->submit) {
+    crystalhd_submit_drain(this->submit);
+    result->submit_stats = this->submit->stats;
+  }
+
+  result->parser_stats = this->nal_parser->stats;
+  result->parser_memory = parser_buf_memory(this->nal_parser);
+  result->nal_units = this->nal_parser->nal_pool->allocated;
+  result->pictures = this->nal_parser->pic_pool->allocated;
+
+  close_decoder(this);
+
+  result->seconds = now() - start;
+  result->counters = bench_counters;
+}
+
+static void sleep_ms(uint32_t ms)
+{
+  struct timespec ts;
+
+  ts.tv_sec = ms / 1000;
+  ts.tv_nsec = (ms % 1000) * 1000000L;
+  nanosleep(&ts, NULL);
+}
+
+/* one DtsProcOutput of a receive loop, a picture is accounted in sched if
+ * the loop has one, else directly in stats */
+static void output_dequeue(struct rec_stats *stats, struct rec_sched *sched,
+    uint32_t timeout)
+{
+  BC_DTS_PROC_OUT procOut;
+
+  memset(&procOut, 0, sizeof(procOut));
+  stats->dequeues++;
+
+  if(DtsProcOutput(hDevice, timeout, &procOut) == BC_STS_SUCCESS &&
+      (procOut.PoutFlags & BC_POUT_FLAGS_PIB_VALID)) {
+    if(sched)
+      crystalhd_rec_sched_frame(sched, procOut.PicInfo.timeStamp, crystalhd_rec_now());
+    else
+      crystalhd_rec_latency_add(&stats->latency, crystalhd_rec_now() - procOut.PicInfo.timeStamp);
+  } else {
+    stats->misses++;
+  }
+}
+
+/* the receive loop of crystalhd_video_rec_thread as it was before the
+ * scheduler: a 16 ms dequeue if the ready list is not empty, then 5 ms sleep */
+static void output_poll(struct rec_stats *stats, int64_t end_us)
+{
+  BC_DTS_STATUS pStatus;
+
+  while(crystalhd_rec_now() < end_us) {
+    stats->wakeups++;
+    if(DtsGetDriverStatus(hDevice, &pStatus) == BC_STS_SUCCESS && pStatus.ReadyListCount)
+      output_dequeue(stats, NULL, 16);
+    stats->sleeps++;
+    sleep_ms(5);
+  }
+}
+
+static void output_sched(struct rec_sched *sched, uint32_t video_step, int64_t end_us)
+{
+  BC_DTS_STATUS pStatus;
+  uint32_t wait_ms;
+  int64_t now_us;
+
+  while((now_us = crystalhd_rec_now()) < end_us) {
+    DtsGetDriverStatus(hDevice, &pStatus);
+    if(crystalhd_rec_sched_next(sched, video_step, pStatus.ReadyListCount,
+          now_us, &wait_ms) == REC_SLEEP)
+      sleep_ms(wait_ms);
+    else
+      output_dequeue(&sched->stats, sched, wait_ms);
+  }
+}
+
+static void run_output(double fps, double seconds, int poll)
+{
+  uint32_t period_us = 1000000 / fps;
+  uint32_t video_step = 90000 / fps;
+  int64_t start_us, frames_end_us;
+  struct rec_sched sched;
+  struct rec_stats *stats = &sched.stats;
+  uint64_t active_wakeups;
+  char latency[256];
+
+  crystalhd_rec_sched_init(&sched);
+  DtsDeviceOpen(&hDevice, 0);
+
+  bench_output_start(period_us, seconds * fps);
+  start_us = crystalhd_rec_now();
+  frames_end_us = start_us + seconds * 1e6;
+
+  if(poll)
+    output_poll(stats, frames_end_us);
+  else
+    output_sched(&sched, video_step, frames_end_us);
+  active_wakeups = stats->wakeups;
+
+  /* the stream ended, the loop is idle for a second */
+  if(poll)
+    output_poll(stats, frames_end_us + 1000000);
+  else
+    output_sched(&sched, video_step, frames_end_us + 1000000);
+
+  DtsDeviceClose(hDevice);
+  hDevice = NULL;
+
+  crystalhd_rec_latency_format(&stats->latency, latency, sizeof(latency));
+  printf("%s receive loop, %.3f fps for %.1f s\n", poll ? "poll" : "sched", fps, seconds);
+  printf("latency         %s\n", latency);
+  printf("wakeups         %.0f/s streaming, %.0f/s idle\n",
+      active_wakeups / seconds, (double)(stats->wakeups - active_wakeups));
+  printf("dequeues        %" PRIu64 " (%" PRIu64 " without picture), %" PRIu64 " sleeps\n",
+      stats->dequeues, stats->misses, stats->sleeps);
+}
+
+struct ring_test {
+  frame_ring_t *ring;
+  uint32_t pictures;
+  uint32_t errors;
+};
+
+static void *ring_producer(void *arg)
+{
+  struct ring_test *test = arg;
+  image_buffer_t img;
+  uint32_t i;
+
+  memset(&img, 0, sizeof(img));
+
+  for(i = 0; i < test->pictures; i++) {
+    img.image = (uint8_t *)(uintptr_t)(i + 1);
+    img.image_bytes = i * 7;
+    img.pts = (uint64_t)i * 3003;
+    img.picture_number = i;
+    while(!crystalhd_ring_push(test->ring, &img))
+      sched_yield();
+  }
+
+  return NULL;
+}
+
+static void *ring_consumer(void *arg)
+{
+  struct ring_test *test = arg;
+  image_buffer_t img;
+  uint32_t i;
+
+  for(i = 0; i < test->pictures; i++) {
+    while(!crystalhd_ring_pop(test->ring, &img))
+      sched_yield();
+    if(img.picture_number != i || img.image != (uint8_t *)(uintptr_t)(i + 1) ||
+        img.image_bytes != i * 7 || img.pts != (uint64_t)i * 3003)
+      test->errors++;
+  }
+
+  return NULL;
+}
+
+static int run_ring(uint32_t pictures)
+{
+  struct ring_test test;
+  pthread_t producer, consumer;
+  double start, seconds;
+  int failed;
+
+  test.ring = crystalhd_ring_create(IMAGE_RING_SIZE);
+  test.pictures = pictures;
+  test.errors = 0;
+
+  start = now();
+  pthread_create(&consumer, NULL, ring_consumer, &test);
+  pthread_create(&producer, NULL, ring_producer, &test);
+  pthread_join(producer, NULL);
+  pthread_join(consumer, NULL);
+  seconds = now() - start;
+
+  printf("image ring      %u pictures through %u slots in %.4f s, %.1f M pictures/s\n",
+      pictures, test.ring->capacity, seconds, pictures / seconds / 1e6);
+  printf("occupancy       max %u mean %.2f, %" PRIu64 " pushes on a full ring, "
+      "%" PRIu64 " pops on an empty one\n",
+      test.ring->producer.max_depth,
+      test.ring->producer.pushed ?
+      (double)test.ring->producer.depth_sum / test.ring->producer.pushed : 0.0,
+      test.ring->producer.full, test.ring->consumer.empty);
+  printf("check           %s, %u pictures out of order or damaged\n",
+      test.errors || test.ring->consumer.popped != pictures ? "FAILED" : "ok",
+      test.errors);
+
+  failed = test.errors || test.ring->consumer.popped != pictures;
+  crystalhd_ring_free(test.ring);
+
+  return failed;
+}
+
+struct frame_test {
+  frame_ring_t *ring;
+  frame_pool_t *pool;
+  uint32_t pictures;
+  uint32_t size;
+  int direct;
+  /* NV12 from the card, YV12 to the vo frame */
+  int yv12;
+  int width;
+  int height;
+};
+
+static void *frame_receiver(void *arg)
+{
+  struct frame_test *test = arg;
+  image_buffer_t img;
+  uint32_t i;
+
+  memset(&img, 0, sizeof(img));
+
+  for(i = 0; i < test->pictures; i++) {
+    if(test->pool) {
+      while(!(img.image = crystalhd_frame_pool_get(test->pool)))
+        sched_yield();
+    } else {
+      img.image = malloc(test->size);
+    }
+    /* the card writes the whole picture */
+    memset(img.image, i, test->size);
+    img.image_bytes = test->size;
+    img.picture_number = i;
+    while(!crystalhd_ring_push(test->ring, &img))
+      sched_yield();
+  }
+
+  return NULL;
+}
+
+static void *frame_renderer(void *arg)
+{
+  struct frame_test *test = arg;
+  uint8_t *vo_frame = malloc(test->size);
+  int chroma_width = (test->width + 1) / 2;
+  uint8_t *planes[3];
+  int pitches[3];
+  image_buffer_t img;
+  uint32_t i;
+
+  memset(vo_frame, 0, test->size);
+
+  /* the planes of a YV12 frame, like xine lays them out */
+  planes[0] = vo_frame;
+  planes[1] = vo_frame + test->width * test->height;
+  planes[2] = planes[1] + chroma_width * ((test->height + 1) / 2);
+  pitches[0] = test->width;
+  pitches[1] = pitches[2] = chroma_width;
+
+  for(i = 0; i < test->pictures; i++) {
+    while(!crystalhd_ring_pop(test->ring, &img))
+      sched_yield();
+    if(test->yv12)
+      crystalhd_yuv_nv12_to_yv12(img.image, img.image + test->width * test->height,
+          test->width, test->height, planes, pitches);
+    else if(!test->direct)
+      memcpy(vo_frame, img.image, img.image_bytes);
+    if(test->pool)
+      crystalhd_frame_pool_put(test->pool, img.image);
+    else
+      free(img.image);
+  }
+
+  free(vo_frame);
+  return NULL;
+}
+
+static double rusage_seconds(struct rusage *usage)
+{
+  return usage->ru_utime.tv_sec + usage->ru_utime.tv_usec / 1e6 +
+    usage->ru_stime.tv_sec + usage->ru_stime.tv_usec / 1e6;
+}
+
+static void run_frames(uint32_t pictures, int width, int height, int pool, int direct,
+    int hugepages, int yv12)
+{
+  struct frame_test test;
+  struct rusage before, after;
+  pthread_t receiver, renderer;
+  double start, seconds, cpu;
+  long faults;
+
+  test.ring = crystalhd_ring_create(IMAGE_RING_SIZE);
+  test.pool = NULL;
+  test.pictures = pictures;
+  test.size = yv12 ? width * height + ((width + 1) / 2) * 2 * ((height + 1) / 2) :
+    width * height * 2;
+  test.direct = direct;
+  test.yv12 = yv12;
+  test.width = width;
+  test.height = height;
+
+  getrusage(RUSAGE_SELF, &before);
+  start = now();
+
+  if(pool) {
+    test.pool = crystalhd_frame_pool_create(FRAME_POOL_SIZE, hugepages);
+    crystalhd_frame_pool_resize(test.pool, test.size);
+  }
+
+  pthread_create(&renderer, NULL, frame_renderer, &test);
+  pthread_create(&receiver, NULL, frame_receiver, &test);
+  pthread_join(receiver, NULL);
+  pthread_join(renderer, NULL);
+
+  if(test.pool)
+    crystalhd_frame_pool_free(test.pool);
+
+  seconds = now() - start;
+  getrusage(RUSAGE_SELF, &after);
+
+  faults = after.ru_minflt - before.ru_minflt;
+  cpu = rusage_seconds(&after) - rusage_seconds(&before);
+
+  printf("%-16s%u pictures of %dx%d %s in %.3f s, %.0f pictures/s\n",
+      direct ? "direct" : pool ? (hugepages ? "pool hugepages" : "pool") : "malloc",
+      pictures, width, height, yv12 ? "NV12 to YV12" : "YUY2", seconds, pictures / seconds);
+  /* the card writes every picture, the renderer reads and writes it once more */
+  printf("bytes moved     %u from the card, %u by the renderer per picture\n",
+      test.size, direct ? 0 : 2 * test.size);
+  printf("page faults     %ld (%.1f per picture)\n", faults, (double)faults / pictures);
+  printf("cpu             %.3f s (%.3f ms per picture)\n", cpu, cpu * 1e3 / pictures);
+
+  crystalhd_ring_free(test.ring);
+}
+
+static void run_stripes(uint32_t pictures, int width, int height, int yv12, int threads)
+{
+  int chroma_width = (width + 1) / 2, chroma_height = (height + 1) / 2;
+  uint32_t size = yv12 ? width * height + chroma_width * 2 * chroma_height : width * height * 2;
+  uint8_t *src = malloc(size), *dst = malloc(size);
+  struct yuv_picture pic;
+  stripe_pool_t *pool;
+  double start, seconds, single = 0;
+  uint32_t i;
+  int n;
+
+  memset(src, 0x80, size);
+  memset(dst, 0, size);
+
+  pic.yv12 = yv12;
+  pic.y = src;
+  pic.uv = src + width * height;
+  pic.width = width;
+  pic.height = height;
+  pic.dst[0] = dst;
+  pic.pitches[0] = yv12 ? width : width * 2;
+  pic.dst[1] = dst + width * height;
+  pic.dst[2] = pic.dst[1] + chroma_width * chroma_height;
+  pic.pitches[1] = pic.pitches[2] = chroma_width;
+  crystalhd_yuv_picture_stream(&pic);
+
+  printf("%u pictures of %dx%d %s\n", pictures, width, height, yv12 ? "NV12 to YV12" : "YUY2");
+
+  for(n = 1; n <= threads; n++) {
+    pool = crystalhd_stripes_create(n - 1);
+
+    start = now();
+    for(i = 0; i < pictures; i++)
+      crystalhd_stripes_run(pool, crystalhd_yuv_picture_rows, &pic, height, yv12 ? 2 : 1);
+    seconds = now() - start;
+
+    if(n == 1)
+      single = seconds;
+    printf("%2d threads      %.3f ms per picture, %.2f GB/s, speedup %.2f\n",
+        n, seconds * 1e3 / pictures, 2.0 * size * pictures / seconds / 1e9, single / seconds);
+
+    crystalhd_stripes_free(pool);
+  }
+
+  free(dst);
+  free(src);
+}
+
+/* pictures copied in turn, at least that many and enough to not fit in
+ * the last level cache */
+#define COPY_BENCH_FRAMES 8
+
+/* render_workers of the decoder by default */
+#define COPY_BENCH_WORKERS 2
+
+/* copies pictures pictures of frames in turn through the stripe workers
+ * of pool like the renderer does, returns the seconds taken */
+static double run_copy_stripes(stripe_pool_t *pool, struct yuv_picture *pic, uint32_t pictures,
+    uint8_t **src, uint8_t **dst, int frames)
+{
+  double start = now();
+  uint32_t i;
+
+  for(i = 0; i < pictures; i++) {
+    pic->y = src[i % frames];
+    pic->dst[0] = dst[i % frames];
+    crystalhd_stripes_run(pool, crystalhd_yuv_picture_rows, pic, pic->height, 1);
+  }
+
+  return now() - start;
+}
+
+static void run_copy_size(stripe_pool_t *pool, uint32_t pictures, int width, int height, int padding)
+{
+  int src_pitch = width * 2, dst_pitch = width * 2 + padding;
+  long cache = sysconf(_SC_LEVEL3_CACHE_SIZE);
+  int frames = COPY_BENCH_FRAMES;
+  uint8_t **src, **dst;
+  struct yuv_picture pic;
+  double start, xine_seconds, cached_seconds, stream_seconds;
+  uint32_t i;
+  int f, stream;
+
+  if(cache > 0 && cache / ((long)src_pitch * height) + 1 > frames)
+    frames = cache / ((long)src_pitch * height) + 1;
+  src = calloc(frames, sizeof(uint8_t *));
+  dst = calloc(frames, sizeof(uint8_t *));
+
+  for(f = 0; f < frames; f++) {
+    /* vo drivers hand out frames aligned at least to a cache line */
+    if(posix_memalign((void **)&src[f], 64, (size_t)src_pitch * height) ||
+        posix_memalign((void **)&dst[f], 64, (size_t)dst_pitch * height))
+      exit(1);
+    memset(src[f], f, (size_t)src_pitch * height);
+    memset(dst[f], 0, (size_t)dst_pitch * height);
+  }
+
+  start = now();
+  for(i = 0; i < pictures; i++)
+    yuy2_to_yuy2(src[i % frames], src_pitch, dst[i % frames], dst_pitch,
+        width, height);
+  xine_seconds = now() - start;
+
+  memset(&pic, 0, sizeof(pic));
+  pic.width = width;
+  pic.height = height;
+  pic.pitches[0] = dst_pitch;
+  crystalhd_yuv_picture_stream(&pic);
+  stream = pic.stream;
+
+  pic.stream = 0;
+  cached_seconds = run_copy_stripes(pool, &pic, pictures, src, dst, frames);
+  pic.stream = 1;
+  stream_seconds = run_copy_stripes(pool, &pic, pictures, src, dst, frames);
+
+  printf("%4dx%-4d %s  yuy2_to_yuy2 %.3f ms  cached %.3f ms (%.2fx)  "
+      "streamed %.3f ms (%.2f GB/s, %.2fx)  decoder %s\n",
+      width, height, padding ? "padded" : "packed",
+      xine_seconds * 1e3 / pictures, cached_seconds * 1e3 / pictures, xine_seconds / cached_seconds,
+      stream_seconds * 1e3 / pictures,
+      2.0 * src_pitch * height * pictures / stream_seconds / 1e9, xine_seconds / stream_seconds,
+      stream ? "streams" : "caches");
+
+  for(f = 0; f < frames; f++) {
+    free(dst[f]);
+    free(src[f]);
+  }
+  free(dst);
+  free(src);
+}
+
+static void run_copy(uint32_t pictures)
+{
+  stripe_pool_t *pool = crystalhd_stripes_create(COPY_BENCH_WORKERS);
+
+  printf("%u YUY2 pictures, time per picture, %d stripe workers\n", pictures, COPY_BENCH_WORKERS);
+  run_copy_size(pool, pictures, 1280, 720, 0);
+  run_copy_size(pool, pictures, 1280, 720, 64);
+  run_copy_size(pool, pictures, 1920, 1080, 0);
+  run_copy_size(pool, pictures, 1920, 1080, 64);
+
+  crystalhd_stripes_free(pool);
+}
+
+/* the first picture is shown that long after it was drawn */
+#define PACE_VO_DELAY 9000
+
+/* renderers of -D */
+enum { PACE_INPUT, PACE_SCHED, PACE_DECIMATE, PACE_LATE };
+static const char *const pace_names[] = { "input", "sched", "decimate", "late" };
+
+/* the decimator alone at level 1 with every picture late, fails if it
+ * drops more than the level allows */
+static int run_late_drops(double fps, double seconds)
+{
+  int64_t step = 90000 / fps;
+  uint32_t pictures = seconds * fps;
+  uint32_t i, dropped = 0, allowed;
+  struct decimate dec;
+
+  crystalhd_decimate_init(&dec);
+  dec.level = 1;
+
+  for(i = 0; i < pictures; i++) {
+    /* the window never closes, so the late pictures don't raise the level */
+    dec.pictures = 0;
+    if(crystalhd_decimate_next(&dec, 1, step, step) != DECIMATE_KEEP)
+      dropped++;
+  }
+
+  /* the level, and the late drop it may take ahead of it */
+  allowed = pictures * dec.level / DECIMATE_PERIOD + 1;
+
+  printf("%-16s%u pictures at %.3f fps, all late, dropping %d of %d\n", pace_names[PACE_LATE],
+      pictures, fps, dec.level, DECIMATE_PERIOD);
+  printf("dropped         %u pictures (%.1f%%), %" PRIu64 " late %" PRIu64 " for the rate, at most %u allowed\n",
+      dropped, 100.0 * dropped / pictures, dec.stats.dropped[DECIMATE_LATE],
+      dec.stats.dropped[DECIMATE_RATE], allowed);
+
+  if(dropped > allowed) {
+    printf("FAILED: late pictures are dropped above the level\n");
+    return 1;
+  }
+  return 0;
+}
+
+static void run_pacing(double fps, double buffers, double seconds, int mode, int draw_us)
+{
+  int64_t step = 90000 / fps;
+  int64_t buffer_step = 90000 / buffers;
+  int64_t draw_ticks = (int64_t)draw_us * 9 / 100;
+  uint32_t pictures = seconds * fps;
+  frame_ring_t *ring = crystalhd_ring_create(IMAGE_RING_SIZE);
+  struct render_sched sched;
+  struct decimate dec;
+  image_buffer_t img, *next;
+  uint32_t made = 0, drawn = 0, dropped = 0, late = 0, wakeups = 0, backlog, max_backlog = 0;
+  uint32_t wait_ms = 0, queued;
+  uint64_t backlog_sum = 0;
+  int64_t t = 0, next_buffer = 0, next_wake = 0, busy_until = 0, vpts_offset = 0, card;
+  int have_offset = 0;
+
+  crystalhd_render_sched_init(&sched);
+  crystalhd_decimate_init(&dec);
+  memset(&img, 0, sizeof(img));
+
+  while(drawn + dropped < pictures) {
+    /* the card finishes a picture every period and keeps it while the ring is full */
+    while(made < pictures && made * step <= t && !crystalhd_ring_full(ring)) {
+      img.pts = (made + 1) * step;
+      img.video_step = step;
+      img.picture_number = made++;
+      crystalhd_ring_push(ring, &img);
+      /* the receive thread wakes the renderer, once it is done drawing */
+      if(mode != PACE_INPUT && next_wake > t)
+        next_wake = (busy_until > t) ? busy_until : t;
+    }
+
+    if(t >= (mode == PACE_INPUT ? next_buffer : next_wake)) {
+      wakeups++;
+      card = t / step + 1;
+      if(card > pictures)
+        card = pictures;
+      backlog = crystalhd_ring_count(ring) + (card - made);
+      backlog_sum += backlog;
+      if(backlog > max_backlog)
+        max_backlog = backlog;
+
+      for(;;) {
+        if(mode == PACE_INPUT) {
+          next_buffer += buffer_step;
+          if(!crystalhd_ring_pop(ring, &img))
+            break;
+        } else {
+          next = crystalhd_ring_peek(ring, 0);
+          queued = crystalhd_ring_count(ring);
+          if(!crystalhd_render_sched_next(&sched, queued,
+                next ? next->pts : 0, step, t, &wait_ms)) {
+            next_wake = t + wait_ms * 90;
+            break;
+          }
+          crystalhd_ring_pop(ring, &img);
+
+          if(mode == PACE_DECIMATE && crystalhd_decimate_next(&dec, queued,
+                crystalhd_render_sched_late(&sched, img.pts, step, t), step) != DECIMATE_KEEP) {
+            crystalhd_render_sched_dropped(&sched, img.pts, step);
+            dropped++;
+            continue;
+          }
+          if(crystalhd_render_sched_skip(&sched, img.pts, step, t, 1)) {
+            dropped++;
+            continue;
+          }
+        }
+
+        /* the metronom maps the first pts to a bit after now and keeps the offset */
+        if(!have_offset) {
+          vpts_offset = t + PACE_VO_DELAY - img.pts;
+          have_offset = 1;
+        }
+        if(img.pts + vpts_offset < t + draw_ticks)
+          late++;
+        if(mode != PACE_INPUT) {
+          crystalhd_render_sched_drawn(&sched, img.pts, step, img.pts + vpts_offset);
+          /* the video output asks to skip a frame per period the picture is late */
+          crystalhd_render_sched_vo_skip(&sched, (img.pts + vpts_offset < t + draw_ticks) ?
+              (t + draw_ticks - img.pts - vpts_offset) / step + 1 : 0);
+        }
+        if(mode == PACE_DECIMATE)
+          crystalhd_decimate_drawn(&dec, draw_us);
+        drawn++;
+
+        /* the renderer is busy drawing, the card goes on meanwhile */
+        if(draw_ticks) {
+          busy_until = t + draw_ticks;
+          if(mode == PACE_INPUT) {
+            if(next_buffer < busy_until)
+              next_buffer = busy_until;
+          } else {
+            next_wake = busy_until;
+          }
+          break;
+        }
+
+        if(mode == PACE_INPUT)
+          break;
+      }
+    }
+
+    /* on to the next event */
+    t = (mode == PACE_INPUT) ? next_buffer : next_wake;
+    if(made < pictures && made * step < t && !crystalhd_ring_full(ring))
+      t = made * step;
+  }
+
+  printf("%-16s%u pictures at %.3f fps", pace_names[mode], pictures, fps);
+  if(mode == PACE_INPUT)
+    printf(", %.3f buffers/s", buffers);
+  if(draw_us)
+    printf(", %d us per draw", draw_us);
+  printf("\n");
+  printf("backlog         max %u mean %.2f pictures, max %.1f mean %.1f ms\n",
+      max_backlog, wakeups ? (double)backlog_sum / wakeups : 0.0,
+      max_backlog * step / 90.0, wakeups ? (double)backlog_sum * step / 90.0 / wakeups : 0.0);
+  printf("late            %u pictures drawn after their display time\n", late);
+  if(mode != PACE_INPUT)
+    printf("skipped         %" PRIu64 " late pictures before the copy, %" PRIu64 " draws answered with a skip\n",
+        sched.stats.skipped_before_copy, sched.stats.skipped_after_copy);
+  if(mode == PACE_DECIMATE) {
+    printf("dropped         %u pictures, %" PRIu64 " late %" PRIu64 " for the rate, at most %u of %d\n",
+        dropped, dec.stats.dropped[DECIMATE_LATE], dec.stats.dropped[DECIMATE_RATE],
+        dec.stats.max_level, DECIMATE_PERIOD);
+    printf("drop rate       raised %u late %u backlog %u slow draw, lowered %u\n",
+        dec.stats.raised[DECIMATE_LATE], dec.stats.raised[DECIMATE_BACKLOG_FULL],
+        dec.stats.raised[DECIMATE_SLOW_DRAW], dec.stats.lowered);
+  }
+  printf("shown           %u pictures (%.1f%%)\n", drawn - late, 100.0 * (drawn - late) / pictures);
+  printf("wakeups         %u (%.1f per picture)\n", wakeups, (double)wakeups / pictures);
+
+  crystalhd_ring_free(ring);
+}
+
+static void usage(const char *name)
+{
+  fprintf(stderr, "usage: %s [-f h264|avcc|vc1] [-x codec_private] [-c chunk] "
+      "[-r runs] [-s full|boundary] [-q depth] [-l usec] [-v] file\n"
+      "       %s -o fps [-t seconds] [-p poll|sched]\n"
+      "       %s -R pictures\n"
+      "       %s -F pictures [-w WxH] [-P malloc|pool|direct] [-H] [-O yuy2|yv12]\n"
+      "       %s -S pictures [-w WxH] [-O yuy2|yv12] [-j threads]\n"
+      "       %s -C pictures\n"
+      "       %s -D fps [-b buffers] [-t seconds] [-m input|sched|decimate|late] [-d usec]\n"
+      "       %s -B name\n", name, name, name, name, name, name, name, name);
+  exit(1);
+}
+
+int main(int argc, char **argv)
+{
+  enum bench_format format = FORMAT_H264;
+  enum slice_parse_mode slice_parse_mode = SLICE_PARSE_BOUNDARY;
+  const char *codec_private_name = NULL;
+  uint8_t *data, *codec_private = NULL;
+  long len, codec_private_len = 0;
+  int chunk = 4096, runs = 5, submit_queue_depth = 8, i, opt;
+  double output_fps = 0, output_seconds = 5;
+  int output_poll_loop = 0;
+  uint32_t ring_pictures = 0, frame_pictures = 0;
+  int frame_width = 1920, frame_height = 1082, frame_pool = 1, frame_direct = 0;
+  int frame_hugepages = 0, frame_yv12 = 0;
+  double pacing_fps = 0, pacing_buffers = 0;
+  int pacing_mode = PACE_SCHED, pacing_draw_us = 0;
+  uint32_t stripe_pictures = 0, copy_pictures = 0;
+  const char *parser_bench = NULL;
+  int stripe_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  struct bench_run best, result;
+  xine_t xine;
+
+  memset(&xine, 0, sizeof(xine));
+  memset(&best, 0, sizeof(best));
+
+  while((opt = getopt(argc, argv, "f:x:c:r:s:q:l:o:t:p:R:F:w:P:HO:S:j:C:D:b:m:d:B:v")) != -1) {
+    switch(opt) {
+      case 'f':
+        if(!strcmp(optarg, "h264"))
+          format = FORMAT_H264;
+        else if(!strcmp(optarg, "avcc"))
+          format = FORMAT_AVCC;
+        else if(!strcmp(optarg, "vc1"))
+          format = FORMAT_VC1;
+        else
+          usage(argv[0]);
+        break;
+      case 'x':
+        codec_private_name = optarg;
+        break;
+      case 'c':
+        chunk = atoi(optarg);
+        break;
+      case 'r':
+        runs = atoi(optarg);
+        break;
+      case 's':
+        if(!strcmp(optarg, "full"))
+          slice_parse_mode = SLICE_PARSE_FULL;
+        else if(!strcmp(optarg, "boundary"))
+          slice_parse_mode = SLICE_PARSE_BOUNDARY;
+        else
+          usage(argv[0]);
+        break;
+      case 'q':
+        submit_queue_depth = atoi(optarg);
+        break;
+      case 'l':
+        bench_input_latency_us = atoi(optarg);
+        break;
+      case 'o':
+        output_fps = atof(optarg);
+        break;
+      case 't':
+        output_seconds = atof(optarg);
+        break;
+      case 'p':
+        if(!strcmp(optarg, "poll"))
+          output_poll_loop = 1;
+        else if(!strcmp(optarg, "sched"))
+          output_poll_loop = 0;
+        else
+          usage(argv[0]);
+        break;
+      case 'R':
+        ring_pictures = atoi(optarg);
+        break;
+      case 'F':
+        frame_pictures = atoi(optarg);
+        break;
+      case 'w':
+        if(sscanf(optarg, "%dx%d", &frame_width, &frame_height) != 2)
+          usage(argv[0]);
+        break;
+      case 'P':
+        if(!strcmp(optarg, "malloc"))
+          frame_pool = 0;
+        else if(!strcmp(optarg, "pool"))
+          frame_pool = 1;
+        else if(!strcmp(optarg, "direct"))
+          frame_direct = 1;
+        else
+          usage(argv[0]);
+        break;
+      case 'H':
+        frame_hugepages = 1;
+        break;
+      case 'O':
+        if(!strcmp(optarg, "yuy2"))
+          frame_yv12 = 0;
+        else if(!strcmp(optarg, "yv12"))
+          frame_yv12 = 1;
+        else
+          usage(argv[0]);
+        break;
+      case 'S':
+        stripe_pictures = atoi(optarg);
+        break;
+      case 'j':
+        stripe_threads = atoi(optarg);
+        break;
+      case 'C':
+        copy_pictures = atoi(optarg);
+        break;
+      case 'D':
+        pacing_fps = atof(optarg);
+        break;
+      case 'b':
+        pacing_buffers = atof(optarg);
+        break;
+      case 'm':
+        if(!strcmp(optarg, "input"))
+          pacing_mode = PACE_INPUT;
+        else if(!strcmp(optarg, "sched"))
+          pacing_mode = PACE_SCHED;
+        else if(!strcmp(optarg, "decimate"))
+          pacing_mode = PACE_DECIMATE;
+        else if(!strcmp(optarg, "late"))
+          pacing_mode = PACE_LATE;
+        else
+          usage(argv[0]);
+        break;
+      case 'd':
+        pacing_draw_us = atoi(optarg);
+        break;
+      case 'B':
+        parser_bench = optarg;
+        break;
+      case 'v':
+        xine.verbosity = XINE_VERBOSITY_LOG;
+        break;
+      default:
+        usage(argv[0]);
+    }
+  }
+
+  if(parser_bench) {
+    if(optind != argc)
+      usage(argv[0]);
+    return bench_parser(&xine, parser_bench);
+  }
+
+  if(ring_pictures > 0) {
+    if(optind != argc)
+      usage(argv[0]);
+    return run_ring(ring_pictures);
+  }
+
+  if(frame_pictures > 0) {
+    /* the card can't write a YV12 frame, direct output is YUY2 only */
+    if(optind != argc || frame_width <= 0 || frame_height <= 0 || (frame_yv12 && frame_direct))
+      usage(argv[0]);
+    run_frames(frame_pictures, frame_width, frame_height, frame_pool || frame_direct,
+        frame_direct, frame_hugepages, frame_yv12);
+    return 0;
+  }
+
+  if(stripe_pictures > 0) {
+    if(optind != argc || frame_width <= 0 || frame_height <= 0 || stripe_threads <= 0)
+      usage(argv[0]);
+    if(stripe_threads > STRIPES_MAX_WORKERS + 1)
+      stripe_threads = STRIPES_MAX_WORKERS + 1;
+    run_stripes(stripe_pictures, frame_width, frame_height, frame_yv12, stripe_threads);
+    return 0;
+  }
+
+  if(copy_pictures > 0) {
+    if(optind != argc)
+      usage(argv[0]);
+    run_copy(copy_pictures);
+    return 0;
+  }
+
+  if(pacing_fps > 0) {
+    if(optind != argc || output_seconds <= 0 || pacing_buffers < 0 || pacing_draw_us < 0)
+      usage(argv[0]);
+    if(pacing_mode == PACE_LATE)
+      return run_late_drops(pacing_fps, output_seconds);
+    run_pacing(pacing_fps, pacing_buffers ? pacing_buffers : pacing_fps / 2,
+        output_seconds, pacing_mode, pacing_draw_us);
+    return 0;
+  }
+
+  if(output_fps > 0) {
+    if(optind != argc || output_seconds <= 0)
+      usage(argv[0]);
+    run_output(output_fps, output_seconds, output_poll_loop);
+    return 0;
+  }
+
+  if(optind != argc - 1 || chunk <= 0 || runs <= 0 || submit_queue_depth < 0)
+    usage(argv[0]);
+  if(format == FORMAT_AVCC && !codec_private_name) {
+    fprintf(stderr, "%s: avcc needs the codec private data (-x)\n", argv[0]);
+    return 1;
+  }
+
+  data = read_file(argv[optind], &len);
+  if(!data)
+    return 1;
+  if(codec_private_name) {
+    codec_private = read_file(codec_private_name, &codec_private_len);
+    if(!codec_private)
+      return 1;
+  }
+
+  for(i = 0; i < runs; i++) {
+    run(&result, &xine, format, slice_parse_mode, submit_queue_depth, data, len,
+        codec_private, codec_private_len, chunk);
+    if(i == 0 || result.seconds < best.seconds)
+      best = result;
+  }
+
+  printf("%s: %ld bytes in %d byte buffers, best of %d runs\n",
+      argv[optind], len, chunk, runs);
+  printf("time            %.4f s\n", best.seconds);
+  printf("throughput      %.1f MB/s\n", len / best.seconds / 1e6);
+  printf("access units    %" PRIu64 " (%.0f/s), %" PRIu64 " bytes sent\n",
+      best.counters.packets_sent, best.counters.packets_sent / best.seconds,
+      best.counters.bytes_sent);
+  printf("allocations     %" PRIu64 " (malloc %" PRIu64 ", calloc %" PRIu64
+      ", realloc %" PRIu64 ", valloc %" PRIu64 ")\n",
+      best.counters.mallocs + best.counters.callocs +
+      best.counters.reallocs + best.counters.vallocs,
+      best.counters.mallocs, best.counters.callocs,
+      best.counters.reallocs, best.counters.vallocs);
+  printf("bytes copied    %" PRIu64 " (%.2f per input byte)\n",
+      best.counters.bytes_copied, (double)best.counters.bytes_copied / len);
+
+  if(format != FORMAT_VC1) {
+    printf("h264 parser     scanned %" PRIu64 " moved %" PRIu64
+        " copied %" PRIu64 " buffer grows %u peak %u memory %u\n",
+        best.parser_stats.bytes_scanned, best.parser_stats.bytes_moved,
+        best.parser_stats.bytes_copied, best.parser_stats.buf_grows,
+        best.parser_stats.buf_peak_size, best.parser_memory);
+    printf("h264 objects    %u nal units %u pictures, %u slices (%u full) "
+        "%u repeated parameter sets\n",
+        best.nal_units, best.pictures, best.parser_stats.slices_parsed,
+        best.parser_stats.slices_parsed_full,
+        best.parser_stats.param_sets_repeated);
+    if(submit_queue_depth > 0)
+      printf("submit queue    %" PRIu64 " sent depth max %u mean %.2f of %d, "
+          "%" PRIu64 " waits on a full queue\n",
+          best.submit_stats.submitted, best.submit_stats.max_depth,
+          best.submit_stats.pushed ?
+          (double)best.submit_stats.depth_sum / best.submit_stats.pushed : 0.0,
+          submit_queue_depth, best.submit_stats.full_waits);
+    else
+      printf("submit queue    off\n");
+  }
+
+  free(codec_private);
+  free(data);
+  return 0;
+}
@@ -0,0 +1,234 @@
+/*
+ * stand-in for the libcrystalhd definitions, only for the crystalhd
+ * bench. the values of the flags do not matter, the bench backend in
+ * bench/bench_dts.c only counts what is sent to it.
+ */
+
+#ifndef BENCH_BC_DTS_DEFS_H
+#define BENCH_BC_DTS_DEFS_H
+
+#include <stdint.h>
+
+typedef enum {
+  BC_STS_SUCCESS = 0,
+  BC_STS_INV_ARG,
+  BC_STS_BUSY,
+  BC_STS_NOT_IMPL,
+  BC_STS_PGM_QUIT,
+  BC_STS_NO_ACCESS,
+  BC_STS_INSUFF_RES,
+  BC_STS_IO_ERROR,
+  BC_STS_NO_DATA,
+  BC_STS_VER_MISMATCH,
+  BC_STS_TIMEOUT,
+  BC_STS_FW_CMD_ERR,
+  BC_STS_DEC_NOT_OPEN,
+  BC_STS_ERR_USAGE,
+  BC_STS_IO_USER_ABORT,
+  BC_STS_IO_XFR_ERROR,
+  BC_STS_DEC_NOT_STARTED,
+  BC_STS_FWHEX_NOT_FOUND,
+  BC_STS_FMT_CHANGE,
+  BC_STS_HIF_ACCESS,
+  BC_STS_CMD_CANCELLED,
+  BC_STS_FW_AUTH_FAILED,
+  BC_STS_BOOTLOADER_FAILED,
+  BC_STS_CERT_VERIFY_ERROR,
+  BC_STS_DEC_EXIST_OPEN,
+  BC_STS_PENDING,
+  BC_STS_CLK_NOCHG,
+  BC_STS_ERROR = -1
+} BC_STATUS;
+
+typedef enum {
+  BC_MSUBTYPE_INVALID = 0,
+  BC_MSUBTYPE_MPEG1VIDEO,
+  BC_MSUBTYPE_MPEG2VIDEO,
+  BC_MSUBTYPE_H264,
+  BC_MSUBTYPE_WVC1,
+  BC_MSUBTYPE_WMV3,
+  BC_MSUBTYPE_AVC1,
+  BC_MSUBTYPE_WMVA,
+  BC_MSUBTYPE_VC1
+} BC_MEDIA_SUBTYPE;
+
+enum {
+  BC_STREAM_TYPE_ES = 0
+};
+
+enum {
+  BC_VID_ALGO_H264  = 0,
+  BC_VID_ALGO_MPEG2 = 1,
+  BC_VID_ALGO_VC1   = 4,
+  BC_VID_ALGO_VC1MP = 7,
+  BC_VID_ALGO_DIVX  = 8
+};
+
+enum {
+  OUTPUT_MODE420 = 0,
+  OUTPUT_MODE422_YUY2,
+  OUTPUT_MODE422_UYVY
+};
+
+#define BC_POUT_FLAGS_YV12          0x01
+#define BC_POUT_FLAGS_STRIDE        0x02
+#define BC_POUT_FLAGS_SIZE          0x04
+#define BC_POUT_FLAGS_INTERLACED    0x08
+#define BC_POUT_FLAGS_INTERLEAVED   0x10
+#define BC_POUT_FLAGS_FMT_CHANGE    0x10000
+#define BC_POUT_FLAGS_PIB_VALID     0x20000
+
+#define VDEC_FLAG_INTERLACED_SRC    0x10
+
+#define DTS_PLAYBACK_MODE           0x0000
+#define DTS_LOAD_FILE_PLAY_FW       0x0001
+#define DTS_PLAYBACK_DROP_RPT_MODE  0x0002
+#define DTS_SINGLE_THREADED_MODE    0x0004
+#define DTS_SKIP_TX_CHK_CPB         0x0008
+#define DTS_DFLT_RESOLUTION(x)      ((x) << 16)
+
+enum {
+  vdecRESOLUTION_CUSTOM = 0,
+  vdecRESOLUTION_1080i,
+  vdecRESOLUTION_NTSC,
+  vdecRESOLUTION_480p,
+  vdecRESOLUTION_720p,
+  vdecRESOLUTION_PAL1,
+  vdecRESOLUTION_1080i25,
+  vdecRESOLUTION_720p50,
+  vdecRESOLUTION_576p,
+  vdecRESOLUTION_1080i29_97,
+  vdecRESOLUTION_720p59_94,
+  vdecRESOLUTION_SD_DVD,
+  vdecRESOLUTION_480p656,
+  vdecRESOLUTION_1080p23_976,
+  vdecRESOLUTION_720p23_976,
+  vdecRESOLUTION_240p29_97,
+  vdecRESOLUTION_240p30,
+  vdecRESOLUTION_288p25,
+  vdecRESOLUTION_1080p29_97,
+  vdecRESOLUTION_1080p30,
+  vdecRESOLUTION_1080p24,
+  vdecRESOLUTION_1080p25,
+  vdecRESOLUTION_720p24,
+  vdecRESOLUTION_720p29_97,
+  vdecRESOLUTION_480p23_976,
+  vdecRESOLUTION_480p29_97,
+  vdecRESOLUTION_576p25,
+  vdecRESOLUTION_480p0,
+  vdecRESOLUTION_480i0,
+  vdecRESOLUTION_576p0,
+  vdecRESOLUTION_720p0,
+  vdecRESOLUTION_1080p0,
+  vdecRESOLUTION_1080i0,
+  vdecRESOLUTION_480i
+};
+
+enum {
+  vdecAspectRatioUnknown = 0,
+  vdecAspectRatioSquare,
+  vdecAspectRatio12_11,
+  vdecAspectRatio10_11,
+  vdecAspectRatio16_11,
+  vdecAspectRatio40_33,
+  vdecAspectRatio24_11,
+  vdecAspectRatio20_11,
+  vdecAspectRatio32_11,
+  vdecAspectRatio80_33,
+  vdecAspectRatio18_11,
+  vdecAspectRatio15_11,
+  vdecAspectRatio64_33,
+  vdecAspectRatio160_99,
+  vdecAspectRatio4_3,
+  vdecAspectRatio16_9,
+  vdecAspectRatio221_1,
+  vdecAspectRatioOther
+};
+
+enum {
+  vdecFrameRateUnknown = 0,
+  vdecFrameRate23_97,
+  vdecFrameRate24,
+  vdecFrameRate25,
+  vdecFrameRate29_97,
+  vdecFrameRate30,
+  vdecFrameRate50,
+  vdecFrameRate59_94,
+  vdecFrameRate60,
+  vdecFrameRate14_985,
+  vdecFrameRate7_496
+};
+
+typedef struct {
+  uint32_t  timeStamp_unused;
+  uint32_t  width;
+  uint32_t  height;
+  uint32_t  chroma_format;
+  uint32_t  pulldown;
+  uint32_t  flags;
+  uint32_t  frame_rate;
+  uint32_t  aspect_ratio;
+  uint32_t  colour_primaries;
+  uint32_t  picture_meta_payload;
+  uint32_t  sess_num;
+  uint32_t  ycom;
+  uint32_t  custom_aspect_ratio_width_height;
+  uint32_t  n_drop;
+  uint32_t  picture_number;
+  uint64_t  timeStamp;
+} BC_PIC_INFO_BLOCK;
+
+typedef struct {
+  uint8_t  *Ybuff;
+  uint32_t  YbuffSz;
+  uint32_t  YBuffDoneSz;
+  uint8_t  *UVbuff;
+  uint32_t  UVbuffSz;
+  uint32_t  UVBuffDoneSz;
+  uint32_t  StrideSz;
+  uint32_t  PoutFlags;
+  uint32_t  discCnt;
+  BC_PIC_INFO_BLOCK PicInfo;
+  uint8_t   b422Mode;
+  uint8_t   bPibEnc;
+  uint8_t   bRevertScramble;
+} BC_DTS_PROC_OUT;
+
+typedef struct {
+  uint8_t   ReadyListCount;
+  uint8_t   FreeListCount;
+  uint8_t   PowerStateChange;
+  uint8_t   reserved_;
+  uint32_t  FramesDropped;
+  uint32_t  FramesCaptured;
+  uint32_t  FramesRepeated;
+  uint32_t  InputCount;
+  uint64_t  InputTotalSize;
+  uint32_t  InputBusyCount;
+  uint32_t  PIBMissCount;
+  uint32_t  cpbEmptySize;
+  uint64_t  NextTimeStamp;
+} BC_DTS_STATUS;
+
+typedef struct {
+  int       FGTEnable;
+  int       MetaDataEnable;
+  int       Progressive;
+  uint32_t  OptFlags;
+  uint32_t  mSubtype;
+  uint32_t  width;
+  uint32_t  height;
+  uint32_t  startCodeSz;
+  uint8_t  *pMetaData;
+  uint32_t  metaDataSz;
+  int       bEnableScaling;
+} BC_INPUT_FORMAT;
+
+typedef struct {
+  uint32_t  sWidth;
+  uint32_t  sHeight;
+  uint32_t  DNR;
+  uint32_t  Reserved1;
+} BC_SCALING_PARAMS;
+
+#endif
@@ -0,0 +1,21 @@
+/*
+ * stand-in for the libcrystalhd type definitions, only for the
+ * crystalhd bench.
+ */
+
+#ifndef BENCH_BC_DTS_TYPES_H
+#define BENCH_BC_DTS_TYPES_H
+
+#include <stdint.h>
+
+typedef void *HANDLE;
+typedef int BOOL;
+
+#define TRUE  1
+#define FALSE 0
+
+typedef uint8_t   U8;
+typedef uint32_t  U32;
+typedef uint64_t  U64;
+
+#endif
@@ -0,0 +1,33 @@
+/*
+ * stand-in for the libcrystalhd interface, implemented by
+ * bench/bench_dts.c for the crystalhd bench.
+ */
+
+#ifndef BENCH_LIBCRYSTALHD_IF_H
+#define BENCH_LIBCRYSTALHD_IF_H
+
+#include <bc_dts_types.h>
+#include <bc_dts_defs.h>
+
+BC_STATUS DtsDeviceOpen(HANDLE *hDevice, uint32_t mode);
+BC_STATUS DtsDeviceClose(HANDLE hDevice);
+BC_STATUS DtsOpenDecoder(HANDLE hDevice, uint32_t StreamType);
+BC_STATUS DtsStartDecoder(HANDLE hDevice);
+BC_STATUS DtsStopDecoder(HANDLE hDevice);
+BC_STATUS DtsCloseDecoder(HANDLE hDevice);
+BC_STATUS DtsStartCapture(HANDLE hDevice);
+BC_STATUS DtsFlushRxCapture(HANDLE hDevice, BOOL bDiscardOnly);
+BC_STATUS DtsFlushInput(HANDLE hDevice, uint32_t Op);
+BC_STATUS DtsProcInput(HANDLE hDevice, uint8_t *pUserData, uint32_t ulSizeInBytes,
+    uint64_t timeStamp, BOOL encrypted);
+BC_STATUS DtsProcOutput(HANDLE hDevice, uint32_t milliSecWait,
+    BC_DTS_PROC_OUT *pOut);
+BC_STATUS DtsProcOutputNoCopy(HANDLE hDevice, uint32_t milliSecWait,
+    BC_DTS_PROC_OUT *pOut);
+BC_STATUS DtsReleaseOutputBuffs(HANDLE hDevice, void *Reserved, BOOL fChange);
+BC_STATUS DtsGetDriverStatus(HANDLE hDevice, BC_DTS_STATUS *pStatus);
+BC_STATUS DtsSetColorSpace(HANDLE hDevice, uint32_t Mode422);
+BC_STATUS DtsSetInputFormat(HANDLE hDevice, BC_INPUT_FORMAT *pInputFormat);
+BC_STATUS DtsSetScaleParams(HANDLE hDevice, BC_SCALING_PARAMS *pScaleParams);
+
+#endif
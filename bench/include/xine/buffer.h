@@ -0,0 +1,47 @@
+/*
+ * stand-in for buffer.h, only for the crystalhd bench.
+ */
+
+#ifndef BENCH_BUFFER_H
+#define BENCH_BUFFER_H
+
+#include <stdint.h>
+
+#define BUF_VIDEO_MPEG              0x02000000
+#define BUF_VIDEO_WMV9              0x02460000
+#define BUF_VIDEO_H264              0x024D0000
+#define BUF_VIDEO_VC1               0x02560000
+
+#define BUF_FLAG_FRAME_START        0x0001
+#define BUF_FLAG_FRAME_END          0x0002
+#define BUF_FLAG_HEADER             0x0008
+#define BUF_FLAG_SPECIAL            0x0200
+#define BUF_FLAG_STDHEADER          0x0400
+
+#define BUF_SPECIAL_DECODER_CONFIG  4
+
+struct buf_element_s {
+  uint8_t  *content;
+  int32_t   size;
+  int64_t   pts;
+  uint32_t  decoder_flags;
+  uint32_t  decoder_info[5];
+  void     *decoder_info_ptr[5];
+  uint32_t  type;
+};
+
+typedef struct {
+  int32_t   biSize;
+  int32_t   biWidth;
+  int32_t   biHeight;
+  uint16_t  biPlanes;
+  uint16_t  biBitCount;
+  uint32_t  biCompression;
+  int32_t   biSizeImage;
+  int32_t   biXPelsPerMeter;
+  int32_t   biYPelsPerMeter;
+  int32_t   biClrUsed;
+  int32_t   biClrImportant;
+} xine_bmiheader;
+
+#endif
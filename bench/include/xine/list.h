@@ -0,0 +1,12 @@
+/*
+ * stand-in for the xine list, only the types are needed by the
+ * decoder structs which the crystalhd bench sets up.
+ */
+
+#ifndef BENCH_XINE_LIST_H
+#define BENCH_XINE_LIST_H
+
+typedef struct xine_list_s xine_list_t;
+typedef void* xine_list_iterator_t;
+
+#endif
@@ -0,0 +1,16 @@
+/*
+ * stand-in for video_out.h, only for the crystalhd bench.
+ */
+
+#ifndef BENCH_VIDEO_OUT_H
+#define BENCH_VIDEO_OUT_H
+
+#include <xine/xine_internal.h>
+
+/* the decoder only keeps pointers to vo frames in the parts the bench runs */
+typedef struct vo_frame_s vo_frame_t;
+
+#define XINE_IMGFMT_YV12 (('2'<<24)|('1'<<16)|('V'<<8)|'Y')
+#define XINE_IMGFMT_YUY2 (('2'<<24)|('Y'<<16)|('U'<<8)|'Y')
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * stand-in for the parts of the xine engine headers which are used by
+ * the parsers and the hardware glue, only for the crystalhd bench.
+ */
+
+#ifndef BENCH_XINE_INTERNAL_H
+#define BENCH_XINE_INTERNAL_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <xine/list.h>
+#include <xine/xineutils.h>
+
+#define XINE_VERBOSITY_NONE   0
+#define XINE_VERBOSITY_LOG    1
+#define XINE_VERBOSITY_DEBUG  2
+
+#define XINE_STREAM_INFO_VIDEO_WIDTH      1
+#define XINE_STREAM_INFO_VIDEO_HEIGHT     2
+#define XINE_STREAM_INFO_VIDEO_RATIO      3
+#define XINE_STREAM_INFO_FRAME_DURATION   4
+
+#define XINE_META_INFO_VIDEOCODEC         1
+
+#define XINE_EVENT_FRAME_FORMAT_CHANGE    1
+
+typedef struct xine_s {
+  int verbosity;
+} xine_t;
+
+typedef struct xine_stream_s {
+  xine_t *xine;
+} xine_stream_t;
+
+typedef struct buf_element_s buf_element_t;
+typedef struct video_decoder_s video_decoder_t;
+typedef struct video_decoder_class_s video_decoder_class_t;
+
+struct video_decoder_s {
+  void (*decode_data) (video_decoder_t *this_gen, buf_element_t *buf);
+  void (*flush) (video_decoder_t *this_gen);
+  void (*reset) (video_decoder_t *this_gen);
+  void (*discontinuity) (video_decoder_t *this_gen);
+  void (*dispose) (video_decoder_t *this_gen);
+};
+
+struct video_decoder_class_s {
+  video_decoder_t* (*open_plugin) (video_decoder_class_t *this_gen,
+      xine_stream_t *stream);
+};
+
+typedef struct {
+  int   type;
+  xine_stream_t *stream;
+  void *data;
+  int   data_length;
+} xine_event_t;
+
+typedef struct {
+  int width;
+  int height;
+  int aspect;
+  int pan_scan;
+} xine_format_change_data_t;
+
+void _x_stream_info_set(xine_stream_t *stream, int info, int value);
+void _x_meta_info_set_utf8(xine_stream_t *stream, int info, const char *str);
+void xine_event_send(xine_stream_t *stream, const xine_event_t *event);
+
+#define xprintf(xine, verbose, ...) \
+  do { \
+    if ((xine) && (xine)->verbosity >= (verbose)) \
+      printf(__VA_ARGS__); \
+  } while(0)
+
+#endif
@@ -0,0 +1,24 @@
+/*
+ * stand-in for xineutils.h, only for the crystalhd bench.
+ * xine_fast_memcpy is a function pointer like in xine, the bench
+ * points it to a memcpy which counts the copied bytes.
+ */
+
+#ifndef BENCH_XINEUTILS_H
+#define BENCH_XINEUTILS_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+extern void *(* xine_fast_memcpy)(void *to, const void *from, size_t len);
+
+void yuy2_to_yuy2(const unsigned char *src, int src_pitch,
+    unsigned char *dst, int dst_pitch, int width, int height);
+
+#ifdef LOG
+#define lprintf(...) printf(__VA_ARGS__)
+#else
+#define lprintf(...) do {} while(0)
+#endif
+
+#endif
@@ -2,66 +2,50 @@
 
 void bits_reader_set( bits_reader_t *br, uint8_t *buf, int len )
 {
-  br->buffer = br->start = buf;
-  br->offbits = 0;
+  br->start = br->ptr = buf;
+  br->end = buf + len;
+  br->cache = 0;
+  br->bits = 0;
   br->length = len;
   br->oflow = 0;
 }
 
-uint32_t read_bits( bits_reader_t *br, int nbits )
+/* skips an arbitrary number of bits, e.g. a whole quant matrix */
+void skip_bits_long( bits_reader_t *br, int nbits )
 {
-  int i, nbytes;
-  uint32_t ret = 0;
-  uint8_t *buf;
+  int pos = bits_tell( br ) + nbits;
 
-  buf = br->buffer;
-  nbytes = (br->offbits + nbits)/8;
-  if ( ((br->offbits + nbits) %8 ) > 0 )
-    nbytes++;
-  if ( (buf + nbytes) > (br->start + br->length) ) {
+  if ( pos > br->length * 8 ) {
     br->oflow = 1;
-    return 0;
+    pos = br->length * 8;
   }
-  for ( i=0; i<nbytes; i++ )
-    ret += buf[i]<<((nbytes-i-1)*8);
-  i = (4-nbytes)*8+br->offbits;
-  ret = ((ret<<i)>>i)>>((nbytes*8)-nbits-br->offbits);
 
-  br->offbits += nbits;
-  br->buffer += br->offbits / 8;
-  br->offbits %= 8;
-
-  return ret;
-}
-
-void skip_bits( bits_reader_t *br, int nbits )
-{
-  br->offbits += nbits;
-  br->buffer += br->offbits / 8;
-  br->offbits %= 8;
-  if ( br->buffer > (br->start + br->length) ) {
-    br->oflow = 1;
-  }
+  br->ptr = br->start + (pos >> 3);
+  br->cache = 0;
+  br->bits = 0;
+  bits_refill( br );
+  br->cache <<= pos & 7;
+  br->bits -= pos & 7;
+  if ( br->bits < 0 )
+    br->bits = 0;
 }
 
-uint32_t get_bits( bits_reader_t *br, int nbits )
+/* copies nbytes from the current (not necessarily byte aligned) position */
+void read_bytes( bits_reader_t *br, uint8_t *dst, int nbytes )
 {
-  int i, nbytes;
-  uint32_t ret = 0;
-  uint8_t *buf;
-
-  buf = br->buffer;
-  nbytes = (br->offbits + nbits)/8;
-  if ( ((br->offbits + nbits) %8 ) > 0 )
-    nbytes++;
-  if ( (buf + nbytes) > (br->start + br->length) ) {
-    br->oflow = 1;
-    return 0;
+  int i;
+
+  if ( !(bits_tell( br ) & 7) ) {
+    int pos = bits_tell( br ) >> 3;
+    if ( pos + nbytes > br->length ) {
+      br->oflow = 1;
+      return;
+    }
+    memcpy( dst, br->start + pos, nbytes );
+    skip_bits_long( br, nbytes * 8 );
+    return;
   }
-  for ( i=0; i<nbytes; i++ )
-    ret += buf[i]<<((nbytes-i-1)*8);
-  i = (4-nbytes)*8+br->offbits;
-  ret = ((ret<<i)>>i)>>((nbytes*8)-nbits-br->offbits);
 
-  return ret;
+  for ( i = 0; i < nbytes; i++ )
+    dst[i] = read_bits( br, 8 );
 }
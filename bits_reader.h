@@ -2,15 +2,104 @@
 #define BITSREADEER_H
 
 #include <stdint.h>
+#include <string.h>
 
+/*
+ * MSB-first bit reader backed by a 64 bit cache.
+ * The cache is left aligned, bits holds the number of valid bits in it
+ * and ptr points to the next byte that has not been loaded yet.
+ */
 typedef struct {
-  uint8_t *buffer, *start;
-  int      offbits, length, oflow;
+  const uint8_t *start, *end, *ptr;
+  uint64_t cache;
+  int      bits, length, oflow;
 } bits_reader_t;
 
 void bits_reader_set( bits_reader_t *br, uint8_t *buf, int len );
-uint32_t read_bits( bits_reader_t *br, int nbits );
-void skip_bits( bits_reader_t *br, int nbits );
-uint32_t get_bits( bits_reader_t *br, int nbits );
+void skip_bits_long( bits_reader_t *br, int nbits );
+void read_bytes( bits_reader_t *br, uint8_t *dst, int nbytes );
+
+static inline uint64_t bits_load_be64( const uint8_t *p )
+{
+  uint64_t v;
+  memcpy( &v, p, sizeof(v) );
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  v = __builtin_bswap64( v );
+#endif
+  return v;
+}
+
+/* fill the cache up to at least 57 bits, or up to the end of the buffer */
+static inline void bits_refill( bits_reader_t *br )
+{
+  if ( br->end - br->ptr >= 8 ) {
+    int n = (64 - br->bits) >> 3;
+    br->cache |= bits_load_be64( br->ptr ) >> br->bits;
+    br->ptr += n;
+    br->bits += n << 3;
+  } else {
+    while ( br->bits <= 56 && br->ptr < br->end ) {
+      br->cache |= (uint64_t)*br->ptr++ << (56 - br->bits);
+      br->bits += 8;
+    }
+  }
+}
+
+/* returns the number of bits consumed so far */
+static inline int bits_tell( const bits_reader_t *br )
+{
+  return (int)(br->ptr - br->start) * 8 - br->bits;
+}
+
+static inline int bits_left( const bits_reader_t *br )
+{
+  return br->length * 8 - bits_tell( br );
+}
+
+/* nbits has to be in the range 0..32 */
+static inline uint32_t get_bits( bits_reader_t *br, int nbits )
+{
+  if ( !nbits )
+    return 0;
+  if ( br->bits < nbits ) {
+    bits_refill( br );
+    if ( br->bits < nbits ) {
+      br->oflow = 1;
+      return 0;
+    }
+  }
+  return (uint32_t)(br->cache >> (64 - nbits));
+}
+
+static inline void skip_bits( bits_reader_t *br, int nbits )
+{
+  if ( nbits < br->bits ) {
+    br->cache <<= nbits;
+    br->bits -= nbits;
+  } else {
+    skip_bits_long( br, nbits );
+  }
+}
+
+/* nbits has to be in the range 0..32 */
+static inline uint32_t read_bits( bits_reader_t *br, int nbits )
+{
+  uint32_t ret;
+
+  if ( !nbits )
+    return 0;
+  if ( br->bits < nbits ) {
+    bits_refill( br );
+    if ( br->bits < nbits ) {
+      br->oflow = 1;
+      return 0;
+    }
+  }
+  ret = (uint32_t)(br->cache >> (64 - nbits));
+  br->cache <<= nbits;
+  br->bits -= nbits;
+
+  return ret;
+}
 
 #endif
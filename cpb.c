@@ -23,15 +23,56 @@
 #include "cpb.h"
 
 #include <stdlib.h>
+#include <string.h>
 
-struct coded_picture* create_coded_picture()
+struct coded_picture_pool* create_coded_picture_pool()
 {
-  struct coded_picture* pic = calloc(1, sizeof(struct coded_picture));
+  return calloc(1, sizeof(struct coded_picture_pool));
+}
+
+/**
+ * frees the pooled pictures. pictures which are still in use
+ * are freed on release, the pool itself with the last of them.
+ */
+void free_coded_picture_pool(struct coded_picture_pool *pool)
+{
+  while(pool->free_list) {
+    struct coded_picture *pic = pool->free_list;
+    pool->free_list = pic->next;
+    free(pic);
+  }
+
+  pool->closed = 1;
+  if(pool->used == 0)
+    free(pool);
+}
+
+struct coded_picture* create_coded_picture(struct coded_picture_pool *pool)
+{
+  struct coded_picture* pic;
+
+  if(pool && pool->free_list) {
+    pic = pool->free_list;
+    pool->free_list = pic->next;
+    memset(pic, 0, sizeof(struct coded_picture));
+  } else {
+    pic = calloc(1, sizeof(struct coded_picture));
+    if(pool)
+      pool->allocated++;
+  }
+
+  pic->pool = pool;
+
+  if(pool && ++pool->used > pool->high_water)
+    pool->high_water = pool->used;
+
   return pic;
 }
 
 void free_coded_picture(struct coded_picture *pic)
 {
+  struct coded_picture_pool *pool;
+
   if(!pic)
     return;
 
@@ -40,6 +81,19 @@ void free_coded_picture(struct coded_picture *pic)
   release_nal_unit(pic->pps_nal);
   release_nal_unit(pic->slc_nal);
 
-  free(pic);
-}
+  pool = pic->pool;
+  if(!pool) {
+    free(pic);
+    return;
+  }
 
+  pool->used--;
+  if(pool->closed) {
+    free(pic);
+    if(pool->used == 0)
+      free(pool);
+  } else {
+    pic->next = pool->free_list;
+    pool->free_list = pic;
+  }
+}
@@ -59,9 +59,29 @@ struct coded_picture
   struct nal_unit *sps_nal;
   struct nal_unit *pps_nal;
   struct nal_unit *slc_nal;
+
+  /* free list link while the picture is in its pool */
+  struct coded_picture *next;
+  struct coded_picture_pool *pool;
 };
 
-struct coded_picture* create_coded_picture(void);
+/* recycles the coded pictures of one parser instead of freeing them */
+struct coded_picture_pool
+{
+  struct coded_picture *free_list;
+
+  uint32_t used;
+  uint32_t high_water;
+  uint32_t allocated;
+
+  /* set when the owner is gone, released pictures are freed then */
+  uint8_t closed;
+};
+
+struct coded_picture_pool* create_coded_picture_pool(void);
+void free_coded_picture_pool(struct coded_picture_pool *pool);
+
+struct coded_picture* create_coded_picture(struct coded_picture_pool *pool);
 void free_coded_picture(struct coded_picture *pic);
 
 #endif /* CPB_H_ */
@@ -0,0 +1,174 @@
+/*
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * crystalhd_copy.c: copies picture planes into vo frames
+ *
+ * A 1080p YUY2 picture is 4 MB. The decoder never reads it back, so
+ * copying it through the cache only evicts everything else. Copies that
+ * take a good part of the last level cache use non-temporal stores
+ * instead, 64 bytes at a time with SSE2 or 128 with AVX, and prefetch the
+ * source ahead. Smaller ones are faster through the cache. When the vo
+ * frame has no padding the plane is one block and is copied in one go.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define COPY_HAVE_AVX
+#endif
+
+#include <xine/xineutils.h>
+
+#include "crystalhd_copy.h"
+
+/* bytes the source is prefetched ahead */
+#define COPY_PREFETCH 512
+
+typedef void (*copy_stream_t)(uint8_t *dst, const uint8_t *src, size_t len);
+
+#ifdef __SSE2__
+static void copy_stream_sse2(uint8_t *dst, const uint8_t *src, size_t len) {
+  size_t head = (16 - ((uintptr_t)dst & 15)) & 15;
+
+  if(head > len)
+    head = len;
+  memcpy(dst, src, head);
+  dst += head;
+  src += head;
+  len -= head;
+
+  for(; len >= 64; len -= 64, dst += 64, src += 64) {
+    __m128i a, b, c, d;
+
+    _mm_prefetch((const char *)src + COPY_PREFETCH, _MM_HINT_NTA);
+    a = _mm_loadu_si128((const __m128i *)src);
+    b = _mm_loadu_si128((const __m128i *)(src + 16));
+    c = _mm_loadu_si128((const __m128i *)(src + 32));
+    d = _mm_loadu_si128((const __m128i *)(src + 48));
+    _mm_stream_si128((__m128i *)dst, a);
+    _mm_stream_si128((__m128i *)(dst + 16), b);
+    _mm_stream_si128((__m128i *)(dst + 32), c);
+    _mm_stream_si128((__m128i *)(dst + 48), d);
+  }
+
+  memcpy(dst, src, len);
+}
+#endif
+
+#if defined(COPY_HAVE_AVX) && defined(__SSE2__)
+__attribute__((target("avx")))
+static void copy_stream_avx(uint8_t *dst, const uint8_t *src, size_t len) {
+  size_t head = (32 - ((uintptr_t)dst & 31)) & 31;
+
+  if(head > len)
+    head = len;
+  memcpy(dst, src, head);
+  dst += head;
+  src += head;
+  len -= head;
+
+  for(; len >= 128; len -= 128, dst += 128, src += 128) {
+    __m256i a, b, c, d;
+
+    _mm_prefetch((const char *)src + COPY_PREFETCH, _MM_HINT_NTA);
+    _mm_prefetch((const char *)src + COPY_PREFETCH + 64, _MM_HINT_NTA);
+    a = _mm256_loadu_si256((const __m256i *)src);
+    b = _mm256_loadu_si256((const __m256i *)(src + 32));
+    c = _mm256_loadu_si256((const __m256i *)(src + 64));
+    d = _mm256_loadu_si256((const __m256i *)(src + 96));
+    _mm256_stream_si256((__m256i *)dst, a);
+    _mm256_stream_si256((__m256i *)(dst + 32), b);
+    _mm256_stream_si256((__m256i *)(dst + 64), c);
+    _mm256_stream_si256((__m256i *)(dst + 96), d);
+  }
+
+  memcpy(dst, src, len);
+}
+#endif
+
+/* 0 until the first copy */
+static size_t stream_min;
+
+static size_t copy_stream_min(void) {
+  long cache;
+
+  if(!stream_min) {
+    stream_min = COPY_STREAM_MIN;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    cache = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if(cache / 2 > COPY_STREAM_MIN)
+      stream_min = cache / 2;
+#endif
+  }
+
+  return stream_min;
+}
+
+static copy_stream_t copy_stream_best(void) {
+  static copy_stream_t best;
+
+#ifdef __SSE2__
+  /* a race only picks the same function twice */
+  if(!best) {
+    best = copy_stream_sse2;
+#ifdef COPY_HAVE_AVX
+    if(__builtin_cpu_supports("avx"))
+      best = copy_stream_avx;
+#endif
+  }
+#endif
+
+  return best;
+}
+
+int crystalhd_copy_stream(size_t bytes) {
+  return bytes >= copy_stream_min() && copy_stream_best() != NULL;
+}
+
+void crystalhd_copy_plane(uint8_t *dst, int dst_pitch, const uint8_t *src, int src_pitch,
+    int width, int height, int streamed) {
+  copy_stream_t stream = streamed ? copy_stream_best() : NULL;
+  int i;
+
+  if(!stream) {
+    if(dst_pitch == width && src_pitch == width) {
+      xine_fast_memcpy(dst, src, (size_t)width * height);
+      return;
+    }
+    for(i = 0; i < height; i++)
+      xine_fast_memcpy(dst + (size_t)i * dst_pitch, src + (size_t)i * src_pitch, width);
+    return;
+  }
+
+  if(dst_pitch == width && src_pitch == width) {
+    stream(dst, src, (size_t)width * height);
+  } else {
+    for(i = 0; i < height; i++)
+      stream(dst + (size_t)i * dst_pitch, src + (size_t)i * src_pitch, width);
+  }
+
+#ifdef __SSE2__
+  /* the stores are weakly ordered, they have to be done before the draw */
+  _mm_sfence();
+#endif
+}
@@ -0,0 +1,40 @@
+/*
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * crystalhd_copy.h: copies picture planes into vo frames
+ */
+
+#ifndef CRYSTALHD_COPY_H
+#define CRYSTALHD_COPY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* copies of at least that many bytes bypass the cache, and at least half
+ * the last level cache if the system tells its size */
+#define COPY_STREAM_MIN   (256 * 1024)
+
+/* whether the copies of a picture of bytes bytes bypass the cache. asked
+ * once for the whole picture, the stripes of the workers are smaller */
+int crystalhd_copy_stream(size_t bytes);
+
+/* copies height rows of width bytes. one copy if both pitches are width,
+ * else row by row, and with non-temporal stores if stream is set */
+void crystalhd_copy_plane(uint8_t *dst, int dst_pitch, const uint8_t *src, int src_pitch,
+    int width, int height, int stream);
+
+#endif
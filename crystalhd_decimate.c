@@ -0,0 +1,155 @@
+/*
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * crystalhd_decimate.c: drops pictures while the video output can't keep
+ * up with the frame rate
+ *
+ * Every DECIMATE_WINDOW pictures the renderer is checked for pressure:
+ * pictures drawn after their display time, a queue that stays long, or
+ * drawing (which includes waiting for a free vo frame) taking most of the
+ * frame period. Under pressure one more picture of every DECIMATE_PERIOD
+ * is dropped, up to half the frame rate. The drops are spread evenly, and
+ * a late picture goes first since the video output would skip it anyway,
+ * but not more than a period ahead of the rate.
+ * After DECIMATE_RECOVER_WINDOWS calm windows, in which drawing one more
+ * picture per period would still fit, a level is given back. Two pictures
+ * in a row are never dropped.
+ */
+
+#include <string.h>
+
+#include "crystalhd_render.h"
+#include "crystalhd_decimate.h"
+
+static const char *const reason_names[DECIMATE_REASONS] = {
+  "kept", "late", "backlog", "slow draw", "rate"
+};
+
+void crystalhd_decimate_init(struct decimate *dec) {
+  memset(dec, 0, sizeof(struct decimate));
+}
+
+static void decimate_new_window(struct decimate *dec) {
+  dec->pictures = 0;
+  dec->late = 0;
+  dec->backlogged = 0;
+  dec->draw_us = 0;
+  dec->stream_us = 0;
+}
+
+void crystalhd_decimate_reset(struct decimate *dec) {
+  dec->level = 0;
+  dec->credit = 0;
+  dec->last_dropped = 0;
+  dec->calm_windows = 0;
+  decimate_new_window(dec);
+}
+
+static void decimate_check(struct decimate *dec) {
+  struct decimate_stats *stats = &dec->stats;
+  int64_t load = dec->stream_us ? dec->draw_us * 100 / dec->stream_us : 0;
+  int cause = DECIMATE_KEEP;
+  int kept;
+
+  if(dec->late >= DECIMATE_LATE_MIN)
+    cause = DECIMATE_LATE;
+  else if(dec->backlogged >= DECIMATE_WINDOW / 2)
+    cause = DECIMATE_BACKLOG_FULL;
+  else if(load > DECIMATE_LOAD_HIGH)
+    cause = DECIMATE_SLOW_DRAW;
+
+  if(cause != DECIMATE_KEEP) {
+    dec->calm_windows = 0;
+    if(dec->level < DECIMATE_MAX_LEVEL) {
+      dec->level++;
+      dec->cause = cause;
+      stats->raised[cause]++;
+      if((uint32_t)dec->level > stats->max_level)
+        stats->max_level = dec->level;
+    }
+  } else if(dec->level) {
+    /* the load if one more picture of every period was drawn */
+    kept = DECIMATE_PERIOD - dec->level;
+    if(!dec->late && !dec->backlogged && load * (kept + 1) / kept < DECIMATE_LOAD_LOW)
+      dec->calm_windows++;
+    else
+      dec->calm_windows = 0;
+
+    if(dec->calm_windows >= DECIMATE_RECOVER_WINDOWS) {
+      dec->level--;
+      dec->calm_windows = 0;
+      stats->lowered++;
+    }
+  }
+
+  decimate_new_window(dec);
+}
+
+int crystalhd_decimate_next(struct decimate *dec, uint32_t queued, int64_t late_ticks,
+    uint32_t video_step) {
+
+  struct decimate_stats *stats = &dec->stats;
+  int64_t step = video_step ? video_step : RENDER_DEFAULT_STEP;
+  int reason = DECIMATE_KEEP;
+
+  /* checked here, so the draw time of the last picture is in */
+  if(dec->pictures >= DECIMATE_WINDOW)
+    decimate_check(dec);
+
+  stats->pictures++;
+  dec->pictures++;
+  dec->stream_us += step * 100 / 9;
+  if(late_ticks > 0)
+    dec->late++;
+  if(queued > DECIMATE_BACKLOG)
+    dec->backlogged++;
+
+  if(dec->level) {
+    stats->decimated++;
+    dec->credit += dec->level;
+    /* a late drop may run ahead of the rate by less than a period, so
+     * on a run of late pictures the level still holds */
+    if(!dec->last_dropped) {
+      if(late_ticks > 0 && dec->credit > 0)
+        reason = DECIMATE_LATE;
+      else if(dec->credit >= DECIMATE_PERIOD)
+        reason = DECIMATE_RATE;
+    }
+    if(reason != DECIMATE_KEEP)
+      dec->credit -= DECIMATE_PERIOD;
+    /* a picture after a drop is kept, the credit it would have used waits */
+    if(dec->credit > DECIMATE_PERIOD)
+      dec->credit = DECIMATE_PERIOD;
+  }
+
+  dec->last_dropped = (reason != DECIMATE_KEEP);
+  if(dec->last_dropped)
+    stats->dropped[reason]++;
+
+  return reason;
+}
+
+void crystalhd_decimate_drawn(struct decimate *dec, int64_t draw_us) {
+  if(draw_us > 0)
+    dec->draw_us += draw_us;
+}
+
+const char *crystalhd_decimate_reason(int reason) {
+  if(reason < 0 || reason >= DECIMATE_REASONS)
+    return "unknown";
+  return reason_names[reason];
+}
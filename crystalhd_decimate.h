@@ -0,0 +1,106 @@
+/*
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * crystalhd_decimate.h: drops pictures while the video output can't keep
+ * up with the frame rate
+ */
+
+#ifndef CRYSTALHD_DECIMATE_H
+#define CRYSTALHD_DECIMATE_H
+
+#include <stdint.h>
+
+/* the drop level is in pictures dropped of that many */
+#define DECIMATE_PERIOD           8
+/* most pictures dropped of DECIMATE_PERIOD, half the frame rate */
+#define DECIMATE_MAX_LEVEL        4
+/* pictures looked at before the level is changed */
+#define DECIMATE_WINDOW           16
+/* windows without pressure before a level is given back */
+#define DECIMATE_RECOVER_WINDOWS  4
+/* late pictures in a window which raise the level */
+#define DECIMATE_LATE_MIN         (DECIMATE_WINDOW / 4)
+/* pictures of a window seen with more than that queued raise the level */
+#define DECIMATE_BACKLOG          4
+/* share of the stream time spent drawing (percent) which raises the
+ * level, and which it has to stay below at the lower level to recover */
+#define DECIMATE_LOAD_HIGH        90
+#define DECIMATE_LOAD_LOW         75
+
+/* why a picture was dropped, or the level raised */
+enum {
+  DECIMATE_KEEP = 0,
+  /* its display time has passed, the video output would skip it */
+  DECIMATE_LATE,
+  /* the pictures queue up faster than they are drawn */
+  DECIMATE_BACKLOG_FULL,
+  /* drawing takes more than the frame period */
+  DECIMATE_SLOW_DRAW,
+  /* dropped to keep the rate of the current level */
+  DECIMATE_RATE,
+  DECIMATE_REASONS
+};
+
+struct decimate_stats {
+  uint64_t  pictures;
+  /* pictures dropped, by reason */
+  uint64_t  dropped[DECIMATE_REASONS];
+  /* times the level went up, by reason, and down */
+  uint32_t  raised[DECIMATE_REASONS];
+  uint32_t  lowered;
+  uint32_t  max_level;
+  /* pictures seen below the full frame rate */
+  uint64_t  decimated;
+};
+
+struct decimate {
+  /* pictures dropped of DECIMATE_PERIOD */
+  int       level;
+  /* adds level per picture, a picture is dropped at DECIMATE_PERIOD */
+  int       credit;
+  int       last_dropped;
+  /* why the level was last raised */
+  int       cause;
+
+  /* the current window */
+  uint32_t  pictures;
+  uint32_t  late;
+  uint32_t  backlogged;
+  int64_t   draw_us;
+  int64_t   stream_us;
+  uint32_t  calm_windows;
+
+  struct decimate_stats stats;
+};
+
+void crystalhd_decimate_init(struct decimate *dec);
+/* back to the full frame rate, after a flush or a discontinuity */
+void crystalhd_decimate_reset(struct decimate *dec);
+
+/* whether the next picture is drawn (DECIMATE_KEEP) or the reason it is
+ * dropped. queued is the number of pictures waiting including this one,
+ * late_ticks how long its display time has passed (90 kHz, not above 0 if
+ * it hasn't or isn't known) and video_step the frame duration. */
+int crystalhd_decimate_next(struct decimate *dec, uint32_t queued, int64_t late_ticks,
+    uint32_t video_step);
+
+/* the picture was drawn in draw_us microseconds */
+void crystalhd_decimate_drawn(struct decimate *dec, int64_t draw_us);
+
+const char *crystalhd_decimate_reason(int reason);
+
+#endif
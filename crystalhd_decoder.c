@@ -35,6 +35,8 @@ static void crystalhd_video_clear_worker_buffers(crystalhd_video_decoder_t *this
 
 HANDLE hDevice = 0;
 
+static const char *const output_format_names[] = { "yuy2", "yv12", NULL };
+
 int __nsleep(const struct  timespec *req, struct timespec *rem) {
   struct timespec temp_rem;
   if(nanosleep(req,rem)==-1)
@@ -79,21 +81,10 @@ void print_setup(crystalhd_video_decoder_t *this) {
 	xprintf(this->xine, XINE_VERBOSITY_LOG, "this->video_step %d\n", this->video_step);
 	xprintf(this->xine, XINE_VERBOSITY_LOG, "this->reported_video_step %d\n", this->reported_video_step);
 	xprintf(this->xine, XINE_VERBOSITY_LOG, "this->ratio %f\n", this->ratio);
-	xprintf(this->xine, XINE_VERBOSITY_LOG, "this->decoder_25p %d\n", this->decoder_25p);
 }
 
 void set_video_params (crystalhd_video_decoder_t *this) {
 
-  this->decoder_25p = 0;
-
-  if(this->decoder_25p_drop) {
-    if(this->video_step < 3000) {
-      xprintf(this->xine, XINE_VERBOSITY_LOG, "enable frame drop hack\n");
-      this->decoder_25p = 1;
-      this->video_step = this->video_step * 2;
-    }
-  }
-
 	_x_stream_info_set( this->stream, XINE_STREAM_INFO_VIDEO_WIDTH, this->width );
 	_x_stream_info_set( this->stream, XINE_STREAM_INFO_VIDEO_HEIGHT, this->height );
 	_x_stream_info_set( this->stream, XINE_STREAM_INFO_VIDEO_RATIO, ((double)10000*this->ratio) );
@@ -115,49 +106,214 @@ void set_video_params (crystalhd_video_decoder_t *this) {
 	print_setup(this);
 } 
 
-static void crystalhd_video_render (crystalhd_video_decoder_t *this, image_buffer_t *_img) {
+/* the sizes of the planes the card delivers, a transfer buffer holds both */
+void crystalhd_video_set_picture_size (crystalhd_video_decoder_t *this) {
+  int height = (this->interlaced) ? this->height / 2 : this->height;
 
-	xine_list_iterator_t ite = NULL;
- 	image_buffer_t *img	= NULL;
+  if(this->picture_format == XINE_IMGFMT_YV12) {
+    this->y_size = this->width * height;
+    this->uv_size = ((this->width + 1) / 2) * 2 * ((height + 1) / 2);
+  } else {
+    this->y_size = this->width * height * 2;
+    this->uv_size = 0;
+  }
+}
 
-  if(this->use_threading) {
-    //pthread_mutex_lock(&this->rec_mutex);
-	  ite = xine_list_front(this->image_buffer);
-    if(ite!= NULL) {
-  	  img	= xine_list_get_value(this->image_buffer, ite);
-		  xine_list_remove(this->image_buffer, ite);
-    }
-    //pthread_mutex_unlock(&this->rec_mutex);
+static void crystalhd_video_release_image (crystalhd_video_decoder_t *this, image_buffer_t *img) {
+  if(img->vo_frame) {
+    img->vo_frame->free(img->vo_frame);
   } else {
-    img = _img;
+    crystalhd_frame_pool_put(this->frame_pool, img->image);
+  }
+}
+
+/* a vo frame for the next picture, NULL if the vo driver pads its lines,
+ * the card writes them packed */
+static vo_frame_t *crystalhd_video_get_direct_frame (crystalhd_video_decoder_t *this) {
+  vo_frame_t	*vo_img;
+
+ 	vo_img = this->stream->video_out->get_frame (this->stream->video_out,
+                    this->width, (this->interlaced) ? this->height / 2 : this->height, this->ratio,
+             				XINE_IMGFMT_YUY2, VO_BOTH_FIELDS | VO_PAN_SCAN_FLAG);
+
+  if(vo_img->pitches[0] != this->width * 2) {
+	  xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: vo pitch %d for width %d, direct output disabled\n",
+        vo_img->pitches[0], this->width);
+    vo_img->free(vo_img);
+    return NULL;
   }
 
- 	if(img != NULL && img->image_bytes > 0) {
-    vo_frame_t	*vo_img;
+  return vo_img;
+}
 
+/* hands img to the video output with the vo flags in flags, returns 0 if
+ * there was nothing to draw. a bad picture is drawn as a bad frame without
+ * the copy, so the metronom still counts it. sets vpts to the one the
+ * metronom gave it and skip to the frames the video output wants skipped.
+ * runs without render_mutex, get_frame blocks while the video output is full */
+static int crystalhd_video_render (crystalhd_video_decoder_t *this, image_buffer_t *img,
+    int flags, int bad, int64_t *vpts, int *skip) {
+
+  vo_frame_t	*vo_img;
+  struct yuv_picture pic;
+
+  if(img->vo_frame != NULL) {
+    vo_img = img->vo_frame;
+    vo_img->flags |= flags;
+  } else if(img->image_bytes > 0) {
    	vo_img = this->stream->video_out->get_frame (this->stream->video_out,
                       img->width, (img->interlaced) ? img->height / 2 : img->height, img->ratio, 
-               				XINE_IMGFMT_YUY2, VO_BOTH_FIELDS | VO_PAN_SCAN_FLAG | this->reset);
+               				img->format, VO_BOTH_FIELDS | VO_PAN_SCAN_FLAG | flags);
+  } else {
+    return 0;
+  }
+
+  if(img->vo_frame == NULL && !bad) {
+    pic.yv12 = (img->format == XINE_IMGFMT_YV12);
+    pic.y = img->image;
+    pic.uv = img->image_uv;
+    pic.width = img->width;
+    pic.height = (img->interlaced) ? img->height / 2 : img->height;
+    memcpy(pic.dst, vo_img->base, sizeof(pic.dst));
+    memcpy(pic.pitches, vo_img->pitches, sizeof(pic.pitches));
+    crystalhd_yuv_picture_stream(&pic);
+
+    /* the whole picture is in the frame when this returns */
+    crystalhd_stripes_run(this->stripes, crystalhd_yuv_picture_rows, &pic,
+        pic.height, pic.yv12 ? 2 : 1);
+  }
+
+ 	vo_img->pts			 = img->pts;
+ 	vo_img->duration = img->video_step;
+  vo_img->bad_frame = bad;
+
+ 	*skip = vo_img->draw(vo_img, this->stream);
+  *vpts = vo_img->vpts;
+
+ 	vo_img->free(vo_img);
+
+  return 1;
+}
+
+/* hands img to the video output, as a bad frame if the decimator drops it
+ * or it is too late to be shown. queued is the number of pictures waiting
+ * including this one. a direct vo frame is freed either way. render_mutex
+ * is taken for the scheduler and the decimator, but not held while drawing. */
+static void crystalhd_video_present (crystalhd_video_decoder_t *this, image_buffer_t *img,
+    uint32_t queued) {
+
+  metronom_clock_t *clock = this->xine->clock;
+  int              reason = DECIMATE_KEEP;
+  int              level;
+  int64_t          now = clock->get_current_time(clock);
+  int64_t          start, vpts = 0;
+  int              skip = 0, flags, drawn, bad = 0;
+  uint32_t         sequence;
+
+  pthread_mutex_lock(&this->render_mutex);
+  level = this->decimate.level;
+  if(this->frame_drop)
+    reason = crystalhd_decimate_next(&this->decimate, queued,
+        crystalhd_render_sched_late(&this->render_sched, img->pts, img->video_step, now),
+        img->video_step);
+
+  if(this->decimate.level != level)
+	  xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: dropping %d of %d pictures (%s)\n",
+        this->decimate.level, DECIMATE_PERIOD,
+        crystalhd_decimate_reason(this->decimate.level > level ? this->decimate.cause : DECIMATE_KEEP));
+
+  if(reason != DECIMATE_KEEP) {
+    crystalhd_render_sched_dropped(&this->render_sched, img->pts, img->video_step);
+    bad = 1;
+  } else if(crystalhd_render_sched_skip(&this->render_sched, img->pts, img->video_step, now,
+        img->vo_frame == NULL)) {
+    /* the video output would throw it away after the copy */
+    bad = 1;
+  }
+
+  /* only the renderer copies with the pool, so it is replaced between pictures */
+  if(this->stripes_changed) {
+    this->stripes_changed = 0;
+    crystalhd_stripes_free(this->stripes);
+    this->stripes = crystalhd_stripes_create(this->render_workers);
+  }
+
+  flags = this->reset;
+  sequence = this->render_sequence;
+  pthread_mutex_unlock(&this->render_mutex);
+
+  /* waiting for a free vo frame counts, it is the video output falling behind */
+  start = crystalhd_rec_now();
+  drawn = crystalhd_video_render(this, img, flags, bad, &vpts, &skip);
 
+  /* a picture of the sequence before a flush says nothing about the new
+   * one, and a bad frame tells nothing about the draw */
+  pthread_mutex_lock(&this->render_mutex);
+  if(drawn && this->render_sequence == sequence) {
     this->reset = 0;
+    if(!bad) {
+      crystalhd_decimate_drawn(&this->decimate, crystalhd_rec_now() - start);
+      crystalhd_render_sched_drawn(&this->render_sched, img->pts, img->video_step, vpts);
+      crystalhd_render_sched_vo_skip(&this->render_sched, skip);
+    }
+  }
+  pthread_mutex_unlock(&this->render_mutex);
+}
 
-   	yuy2_to_yuy2(
-    		  	img->image, img->width * 2,
- 		      	vo_img->base[0], vo_img->pitches[0],
- 		  	    img->width, (img->interlaced) ? img->height / 2 : img->height);
-   	vo_img->pts			 = img->pts;
-   	vo_img->duration = img->video_step;
-    vo_img->bad_frame = 0;
+/* draws the queued pictures which are due and sets wait_ms to the time
+ * until the next one is. a picture is taken from the ring under
+ * render_mutex, flushes wait for that but not for the drawing */
+static void crystalhd_video_render_due (crystalhd_video_decoder_t *this, uint32_t *wait_ms) {
+
+  metronom_clock_t *clock = this->xine->clock;
+  image_buffer_t   img;
+  image_buffer_t   *next;
+  uint32_t         queued;
+  int              due;
+
+  for(;;) {
+    pthread_mutex_lock(&this->render_mutex);
+    next = crystalhd_ring_peek(this->image_ring, 0);
+    queued = crystalhd_ring_count(this->image_ring);
+    due = !this->render_thread_stop &&
+        crystalhd_render_sched_next(&this->render_sched, queued,
+          next ? next->pts : 0, next ? next->video_step : this->video_step,
+          clock->get_current_time(clock), wait_ms);
+    if(due)
+      crystalhd_ring_pop(this->image_ring, &img);
+    pthread_mutex_unlock(&this->render_mutex);
+    if(!due)
+      break;
 
-   	vo_img->draw(vo_img, this->stream);
+    crystalhd_video_present(this, &img, queued);
 
-   	vo_img->free(vo_img);
+    /* a direct vo frame was freed with the draw or the drop */
+    if(img.vo_frame == NULL)
+      crystalhd_frame_pool_put(this->frame_pool, img.image);
   }
+}
+
+static void *crystalhd_video_render_thread (void *this_gen) {
+	crystalhd_video_decoder_t *this = (crystalhd_video_decoder_t *) this_gen;
+
+  uint32_t        wait_ms = RENDER_IDLE_MAX_MS;
+  struct timespec ts;
 
-  if(img != NULL && this->use_threading) {
-  	free(img->image);
-    free(img);
+  while(!this->render_thread_stop) {
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += wait_ms / 1000;
+    ts.tv_nsec += (wait_ms % 1000) * 1000000L;
+    if(ts.tv_nsec >= 1000000000L) {
+      ts.tv_sec++;
+      ts.tv_nsec -= 1000000000L;
+    }
+    /* a new picture or the next one being due, whichever comes first */
+    sem_timedwait(&this->render_wake, &ts);
+
+    crystalhd_video_render_due(this, &wait_ms);
   }
+
+  return NULL;
 }
 
 void* crystalhd_video_rec_thread (void *this_gen) {
@@ -167,7 +323,10 @@ void* crystalhd_video_rec_thread (void *this_gen) {
 	BC_DTS_STATUS     pStatus;
   BC_DTS_PROC_OUT		procOut;
 	unsigned char   	*transferbuff = NULL;
-	int								decoder_timeout = 16;
+  vo_frame_t        *direct_frame = NULL;
+  int               direct_unusable = 0;
+	uint32_t					decoder_timeout = 16;
+  int               dequeue;
 
 	while(!this->rec_thread_stop) {
 	
@@ -183,14 +342,28 @@ void* crystalhd_video_rec_thread (void *this_gen) {
     memset(&pStatus, 0, sizeof(BC_DTS_STATUS));
     ret = DtsGetDriverStatus(hDevice, &pStatus);
 
-		if( ret == BC_STS_SUCCESS && pStatus.ReadyListCount) {
+    if(this->use_threading) {
+      /* with a full ring the renderer is behind, the pictures wait in the card */
+      if(crystalhd_rec_sched_next(&this->rec_sched, this->video_step,
+            (ret == BC_STS_SUCCESS) ? pStatus.ReadyListCount : 0,
+            crystalhd_rec_now(), &decoder_timeout) == REC_SLEEP ||
+          crystalhd_ring_full(this->image_ring)) {
+        msleep(decoder_timeout);
+        continue;
+      }
+      dequeue = 1;
+    } else {
+      dequeue = (ret == BC_STS_SUCCESS && pStatus.ReadyListCount);
+    }
+
+		if(dequeue) {
 
 			memset(&procOut, 0, sizeof(BC_DTS_PROC_OUT));
 
 		  if(this->interlaced) {
 			  procOut.PoutFlags |= BC_POUT_FLAGS_INTERLACED;
 		  }
-      procOut.b422Mode = OUTPUT_MODE422_YUY2;
+      procOut.b422Mode = (this->picture_format == XINE_IMGFMT_YV12) ? OUTPUT_MODE420 : OUTPUT_MODE422_YUY2;
 
       if(this->use_threading) {
 			
@@ -202,15 +375,48 @@ void* crystalhd_video_rec_thread (void *this_gen) {
 			  procOut.PoutFlags = BC_POUT_FLAGS_SIZE;
 	
 			  procOut.PicInfo.picture_number = 0;
+
+        /* held across a restart of the decoder, which may have changed the format */
+        if(transferbuff && crystalhd_frame_pool_buf_size(transferbuff) < this->y_size + this->uv_size) {
+          crystalhd_frame_pool_put(this->frame_pool, transferbuff);
+          transferbuff = NULL;
+        }
+        if(direct_frame && this->picture_format != XINE_IMGFMT_YUY2) {
+          direct_frame->free(direct_frame);
+          direct_frame = NULL;
+        }
 	
-			  if(transferbuff == NULL) {
-				  transferbuff = malloc(this->y_size);
+			  if(transferbuff == NULL && direct_frame == NULL) {
+          /* the card writes NV12, which has to be split for a YV12 frame */
+          if(this->direct_output && this->picture_format == XINE_IMGFMT_YUY2 && !direct_unusable) {
+            if(crystalhd_ring_count(this->image_ring) >= DIRECT_FRAMES_MAX) {
+              msleep(decoder_timeout);
+              continue;
+            }
+            direct_frame = crystalhd_video_get_direct_frame(this);
+            direct_unusable = (direct_frame == NULL);
+          }
+          if(direct_frame == NULL) {
+				    transferbuff = crystalhd_frame_pool_get(this->frame_pool);
+            if(transferbuff == NULL) {
+              /* all buffers are queued or being rendered */
+              msleep(decoder_timeout);
+              continue;
+            }
+          }
 		  	}
-			  procOut.Ybuff = transferbuff;
+			  procOut.Ybuff = direct_frame ? direct_frame->base[0] : transferbuff;
+        if(this->uv_size)
+          procOut.UVbuff = transferbuff + this->y_size;
 
 			  procOut.PoutFlags = procOut.PoutFlags & 0xff;
 	
   			ret = DtsProcOutput(hDevice, decoder_timeout, &procOut);
+
+        if(ret == BC_STS_SUCCESS && (procOut.PoutFlags & BC_POUT_FLAGS_PIB_VALID))
+          crystalhd_rec_sched_frame(&this->rec_sched, 0, crystalhd_rec_now());
+        else
+          crystalhd_rec_sched_miss(&this->rec_sched);
       } else {	
   			ret = DtsProcOutputNoCopy(hDevice, decoder_timeout, &procOut);
       }
@@ -231,15 +437,19 @@ void* crystalhd_video_rec_thread (void *this_gen) {
 						this->height = procOut.PicInfo.height;
 						if(this->height == 1088) this->height = 1080;
 
-						if(this->interlaced) {
-							this->y_size = this->width * this->height;
-						} else {
-							this->y_size = this->width * this->height * 2;
-						}
+            crystalhd_video_set_picture_size(this);
 
-						this->uv_size = 0;
-	
-						decoder_timeout = 16;
+            /* the buffer for the next picture has to be of the new size */
+            if(this->use_threading) {
+              crystalhd_frame_pool_resize(this->frame_pool, this->y_size + this->uv_size);
+              crystalhd_frame_pool_put(this->frame_pool, transferbuff);
+              transferbuff = NULL;
+              if(direct_frame) {
+                direct_frame->free(direct_frame);
+                direct_frame = NULL;
+              }
+              direct_unusable = 0;
+            }
 				
 						this->ratio = set_ratio(this->width, this->height, procOut.PicInfo.aspect_ratio);
             set_video_params(this);
@@ -277,25 +487,22 @@ void* crystalhd_video_rec_thread (void *this_gen) {
 								this->last_image = procOut.PicInfo.picture_number;
 							}
 
-              /* Hack to drop every second frame */
-              if(this->decoder_25p && (procOut.PicInfo.picture_number % 2)) {
-                continue;
-              }
-
-							image_buffer_t *img = NULL;
               image_buffer_t _img;
+							image_buffer_t *img = &_img;
 
-							/* allocate new image buffer and push it to the image list */
+              memset(&_img, 0 , sizeof(image_buffer_t));
               if(this->use_threading) {
-							  img = malloc(sizeof(image_buffer_t));
 							  img->image = transferbuff;
+                img->vo_frame = direct_frame;
 							  img->image_bytes = procOut.YbuffSz;
+                if(this->uv_size)
+                  img->image_uv = transferbuff + this->y_size;
               } else {
-                memset(&_img, 0 , sizeof(image_buffer_t));
-                img = &_img;
 							  img->image = procOut.Ybuff;
 							  img->image_bytes = procOut.YBuffDoneSz;
+                img->image_uv = procOut.UVbuff;
               }
+              img->format = this->picture_format;
 
 							img->width = this->width;
 							img->height = this->height;
@@ -306,13 +513,22 @@ void* crystalhd_video_rec_thread (void *this_gen) {
 							img->picture_number = procOut.PicInfo.picture_number;
 
               if(this->use_threading) {
+                if(direct_frame) {
+                  this->direct_frames++;
+                } else {
+                  this->copied_frames++;
+                }
   							transferbuff = NULL;
-
-	  	          //pthread_mutex_lock(&this->rec_mutex);
-		  					xine_list_push_back(this->image_buffer, img);
-		            //pthread_mutex_unlock(&this->rec_mutex);
+                direct_frame = NULL;
+
+                /* can't fail, only this thread fills the ring and it was not full */
+		  					if(crystalhd_ring_push(this->image_ring, img)) {
+                  sem_post(&this->render_wake);
+                } else {
+                  crystalhd_video_release_image(this, img);
+                }
               } else {
-                crystalhd_video_render(this, img);
+                crystalhd_video_present(this, img, 1);
               }
 
 						}
@@ -334,18 +550,21 @@ void* crystalhd_video_rec_thread (void *this_gen) {
 	   	}
 		}
 
-    if(this->use_threading) {
-      msleep(5);
-    } else {
+    if(!this->use_threading) {
       break;
-   }
+    }
 	}
 
   if(transferbuff) {
-	  free(transferbuff);
+	  crystalhd_frame_pool_put(this->frame_pool, transferbuff);
 	  transferbuff = NULL;
   }
 
+  if(direct_frame) {
+    direct_frame->free(direct_frame);
+    direct_frame = NULL;
+  }
+
   if(this->use_threading) {
 	  pthread_exit(NULL);
   }
@@ -388,10 +607,6 @@ static void crystalhd_video_decode_data (video_decoder_t *this_gen,
     crystalhd_video_rec_thread(this);
   }
 
-  if(this->use_threading) {
-    crystalhd_video_render(this, NULL);
-  }
-
   switch(this->deocder_type) {
     case BUF_VIDEO_VC1:
     case BUF_VIDEO_WMV9:
@@ -408,13 +623,24 @@ static void crystalhd_video_decode_data (video_decoder_t *this_gen,
 
 }
 
+static void crystalhd_video_flush_submit(crystalhd_video_decoder_t *this) {
+  /* queued access units must not reach the decoder after its input was flushed */
+  if(this->submit)
+    crystalhd_submit_flush(this->submit);
+}
+
 static void crystalhd_video_clear_all_pts(crystalhd_video_decoder_t *this) {
 
-	xine_list_iterator_t ite;
-	while ((ite = xine_list_front(this->image_buffer)) != NULL) {
-		image_buffer_t	*img = xine_list_get_value(this->image_buffer, ite);
+  image_buffer_t *img;
+  uint32_t i;
+
+  pthread_mutex_lock(&this->render_mutex);
+  for(i = 0; (img = crystalhd_ring_peek(this->image_ring, i)) != NULL; i++) {
     img->pts = 0;
 	}
+  pthread_mutex_unlock(&this->render_mutex);
+
+  crystalhd_video_flush_submit(this);
 
 	if(hDevice) {
 		DtsFlushInput(hDevice, 1);
@@ -425,31 +651,50 @@ static void crystalhd_video_clear_all_pts(crystalhd_video_decoder_t *this) {
 }
 
 static void crystalhd_video_clear_worker_buffers(crystalhd_video_decoder_t *this) {
-	xine_list_iterator_t ite;
+  image_buffer_t img;
 
   //lprintf("crystalhd_video_clear_worker_buffers enter\n");
 
+  crystalhd_video_flush_submit(this);
+
 	if(hDevice) {
 		DtsFlushInput(hDevice, 1);
 	}
 
-	while ((ite = xine_list_front(this->image_buffer)) != NULL) {
-		image_buffer_t	*img = xine_list_get_value(this->image_buffer, ite);
-		free(img->image);
-		free(img);
-		xine_list_remove(this->image_buffer, ite);
+  pthread_mutex_lock(&this->render_mutex);
+	while (crystalhd_ring_pop(this->image_ring, &img)) {
+		crystalhd_video_release_image(this, &img);
 	}
+  pthread_mutex_unlock(&this->render_mutex);
 
   //lprintf("crystalhd_video_clear_worker_buffers leave\n");
 }
 
+/* the next picture starts a new sequence, its vpts is learned again */
+static void crystalhd_video_new_sequence(crystalhd_video_decoder_t *this) {
+  pthread_mutex_lock(&this->render_mutex);
+  this->reset = VO_NEW_SEQUENCE_FLAG;
+  this->render_sequence++;
+  crystalhd_render_sched_reset(&this->render_sched);
+  crystalhd_decimate_reset(&this->decimate);
+  pthread_mutex_unlock(&this->render_mutex);
+}
+
 static void crystalhd_video_destroy_workers(crystalhd_video_decoder_t *this) {
 
-  if(this->use_threading) {
-  	if(this->rec_thread) {
-	  	this->rec_thread_stop = 1;
-	  }
-	  pthread_mutex_destroy(&this->rec_mutex);
+  /* the thread fills the image ring, it has to be gone before the ring */
+  if(this->rec_thread) {
+  	this->rec_thread_stop = 1;
+    pthread_join(this->rec_thread, NULL);
+    this->rec_thread = 0;
+  }
+
+  /* and the renderer, which takes the pictures out of the ring */
+  if(this->render_thread) {
+    this->render_thread_stop = 1;
+    sem_post(&this->render_wake);
+    pthread_join(this->render_thread, NULL);
+    this->render_thread = 0;
   }
 
 }
@@ -461,9 +706,8 @@ static void crystalhd_video_setup_workers(crystalhd_video_decoder_t *this) {
     pthread_attr_init(&thread_attr);
     pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_JOINABLE);
     pthread_create(&this->rec_thread, &thread_attr,crystalhd_video_rec_thread,(void *)this);
+    pthread_create(&this->render_thread, &thread_attr,crystalhd_video_render_thread,(void *)this);
     pthread_attr_destroy(&thread_attr);
-
-	  pthread_mutex_init(&this->rec_mutex, NULL);
   }
 
 }
@@ -476,7 +720,7 @@ static void crystalhd_video_flush (video_decoder_t *this_gen) {
 
 	crystalhd_video_clear_worker_buffers(this);
 
-  this->reset = VO_NEW_SEQUENCE_FLAG;
+  crystalhd_video_new_sequence(this);
 
 	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: crystalhd_video_decode_flush\n");
 }
@@ -496,8 +740,7 @@ static void crystalhd_video_reset (video_decoder_t *this_gen) {
       crystalhd_vc1_reset_sequence( &this->sequence_vc1 );
       break;
     case BUF_VIDEO_H264:
-      crystalhd_h264_free_parser(this);
-      this->nal_parser = init_parser(this->xine);
+      crystalhd_h264_reset_parser(this);
 	    if(this->extradata_size > 0) {
 		    parse_codec_private(this->nal_parser, this->extradata, this->extradata_size);
         this->wait_for_frame_start = this->have_frame_boundary_marks;
@@ -512,7 +755,7 @@ static void crystalhd_video_reset (video_decoder_t *this_gen) {
 
   this->set_form          = 0;
 
-  this->reset = VO_NEW_SEQUENCE_FLAG;
+  crystalhd_video_new_sequence(this);
 
 	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: crystalhd_video_reset\n");
 }
@@ -532,7 +775,7 @@ static void crystalhd_video_discontinuity (video_decoder_t *this_gen) {
       break;
   }
 
-  this->reset = VO_NEW_SEQUENCE_FLAG;
+  crystalhd_video_new_sequence(this);
 
 	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: crystalhd_video_discontinuity\n");
 }
@@ -546,10 +789,87 @@ static void crystalhd_video_dispose (video_decoder_t *this_gen) {
 
 	crystalhd_video_destroy_workers(this);
 
+  if(this->use_threading) {
+    struct rec_stats *stats = &this->rec_sched.stats;
+    char latency[256];
+
+    crystalhd_rec_latency_format(&stats->latency, latency, sizeof(latency));
+	  xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: receive latency %s\n", latency);
+	  xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: receive %" PRIu64 " wakeups %" PRIu64 " sleeps "
+        "%" PRIu64 " dequeues %" PRIu64 " without picture\n",
+        stats->wakeups, stats->sleeps, stats->dequeues, stats->misses);
+  }
+
+  if(this->submit) {
+    struct submit_stats *stats = &this->submit->stats;
+    crystalhd_submit_flush(this->submit);
+	  xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: submit queue %" PRIu64 " sent %" PRIu64 " flushed, "
+        "depth max %u mean %.2f of %u, %" PRIu64 " waits on a full queue\n",
+        stats->submitted, stats->flushed, stats->max_depth,
+        stats->pushed ? (double)stats->depth_sum / stats->pushed : 0.0,
+        this->submit->capacity, stats->full_waits);
+    crystalhd_submit_free(this->submit);
+    this->submit = NULL;
+  }
+
 	hDevice = crystalhd_stop(this, hDevice);
 
 	crystalhd_video_clear_worker_buffers(this);
-  xine_list_delete(this->image_buffer);
+  if(this->use_threading) {
+    struct frame_ring_producer_stats *stats = &this->image_ring->producer;
+	  xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: image ring %" PRIu64 " pictures, "
+        "depth max %u mean %.2f of %u\n",
+        stats->pushed, stats->max_depth,
+        stats->pushed ? (double)stats->depth_sum / stats->pushed : 0.0,
+        this->image_ring->capacity);
+  }
+  crystalhd_ring_free(this->image_ring);
+  if(this->use_threading) {
+    struct frame_pool_stats *stats = &this->frame_pool->stats;
+	  xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: frame pool %" PRIu64 " buffers mapped, "
+        "%" PRIu64 " reused, %u resizes, %" PRIu64 " times exhausted\n",
+        stats->allocs, stats->reuses, stats->resizes, stats->exhausted);
+	  xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: %" PRIu64 " pictures received into vo frames, "
+        "%" PRIu64 " copied\n", this->direct_frames, this->copied_frames);
+  }
+  crystalhd_frame_pool_free(this->frame_pool);
+  if(this->use_threading) {
+    struct render_stats *stats = &this->render_sched.stats;
+	  xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: render %" PRIu64 " pictures, %" PRIu64 " before they were due, "
+        "backlog max %u mean %.2f pictures, max %u mean %.1f ms\n",
+        stats->drawn, stats->forced,
+        stats->max_backlog, stats->samples ? (double)stats->backlog_sum / stats->samples : 0.0,
+        stats->max_backlog_ms, stats->samples ? (double)stats->backlog_ms_sum / stats->samples : 0.0);
+  }
+  if(this->render_sched.stats.drawn) {
+    struct render_stats *stats = &this->render_sched.stats;
+	  xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: %" PRIu64 " late pictures skipped before the copy, "
+        "%" PRIu64 " draws answered with a skip request\n",
+        stats->skipped_before_copy, stats->skipped_after_copy);
+  }
+  if(this->decimate.stats.pictures) {
+    struct decimate_stats *stats = &this->decimate.stats;
+	  xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: dropped %" PRIu64 " of %" PRIu64 " pictures, "
+        "%" PRIu64 " late %" PRIu64 " for the rate, %" PRIu64 " pictures below the full rate, "
+        "at most %u of %d dropped\n",
+        stats->dropped[DECIMATE_LATE] + stats->dropped[DECIMATE_RATE], stats->pictures,
+        stats->dropped[DECIMATE_LATE], stats->dropped[DECIMATE_RATE], stats->decimated,
+        stats->max_level, DECIMATE_PERIOD);
+	  xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: drop rate raised %u times for late pictures "
+        "%u for the backlog %u for slow draws, lowered %u times\n",
+        stats->raised[DECIMATE_LATE], stats->raised[DECIMATE_BACKLOG_FULL],
+        stats->raised[DECIMATE_SLOW_DRAW], stats->lowered);
+  }
+  if(this->stripes) {
+    struct stripe_stats *stats = &this->stripes->stats;
+	  xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: %d render workers copied %" PRIu64 " of %" PRIu64 " stripes "
+        "of %" PRIu64 " pictures\n",
+        this->stripes->workers, stats->worker_stripes, stats->stripes, stats->jobs);
+    crystalhd_stripes_free(this->stripes);
+    this->stripes = NULL;
+  }
+  sem_destroy(&this->render_wake);
+  pthread_mutex_destroy(&this->render_mutex);
 
   free(this->sequence_vc1.bytestream);
   this->sequence_vc1.bytestream_bytes = 0;
@@ -598,6 +918,44 @@ void crystalhd_use_threading( void *this_gen, xine_cfg_entry_t *entry )
 	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: use_threading %d\n", this->use_threading);
 }
 
+void crystalhd_hugepage_buffers( void *this_gen, xine_cfg_entry_t *entry )
+{
+  crystalhd_video_decoder_t  *this  = (crystalhd_video_decoder_t *) this_gen;
+
+  /* the frame pool is created when the decoder is opened */
+  this->hugepage_buffers = entry->num_value;
+	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: hugepage_buffers %d\n", this->hugepage_buffers);
+}
+
+void crystalhd_direct_output( void *this_gen, xine_cfg_entry_t *entry )
+{
+  crystalhd_video_decoder_t  *this  = (crystalhd_video_decoder_t *) this_gen;
+
+  this->direct_output = entry->num_value;
+	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: direct_output %d\n", this->direct_output);
+}
+
+void crystalhd_output_format( void *this_gen, xine_cfg_entry_t *entry )
+{
+  crystalhd_video_decoder_t  *this  = (crystalhd_video_decoder_t *) this_gen;
+
+  /* the card is told when the decoder is started */
+  this->output_format = entry->num_value;
+	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: output_format %d\n", this->output_format);
+}
+
+void crystalhd_render_workers( void *this_gen, xine_cfg_entry_t *entry )
+{
+  crystalhd_video_decoder_t  *this  = (crystalhd_video_decoder_t *) this_gen;
+
+  /* the renderer may be copying, it starts the new workers itself */
+  pthread_mutex_lock(&this->render_mutex);
+  this->render_workers = entry->num_value;
+  this->stripes_changed = 1;
+  pthread_mutex_unlock(&this->render_mutex);
+	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: render_workers %d\n", this->render_workers);
+}
+
 void crystalhd_extra_logging( void *this_gen, xine_cfg_entry_t *entry )
 {
   crystalhd_video_decoder_t  *this  = (crystalhd_video_decoder_t *) this_gen;
@@ -614,12 +972,31 @@ void crystalhd_decoder_reopen( void *this_gen, xine_cfg_entry_t *entry )
 	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: decoder_reopen %d\n", this->decoder_reopen);
 }
 
-void crystalhd_decoder_25p_drop( void *this_gen, xine_cfg_entry_t *entry )
+void crystalhd_frame_drop( void *this_gen, xine_cfg_entry_t *entry )
 {
   crystalhd_video_decoder_t  *this  = (crystalhd_video_decoder_t *) this_gen;
 
-  this->decoder_25p_drop = entry->num_value;
-	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: decoder_25p_drop %d\n", this->decoder_25p_drop);
+  this->frame_drop = entry->num_value;
+	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: frame_drop %d\n", this->frame_drop);
+}
+
+void crystalhd_h264_buffer_limit( void *this_gen, xine_cfg_entry_t *entry )
+{
+  crystalhd_video_decoder_t  *this  = (crystalhd_video_decoder_t *) this_gen;
+
+  this->h264_buffer_limit = entry->num_value;
+  if(this->nal_parser)
+    set_parser_max_buf_size(this->nal_parser, (size_t)this->h264_buffer_limit * 1024);
+	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: h264_buffer_limit %d\n", this->h264_buffer_limit);
+}
+
+void crystalhd_submit_queue_depth( void *this_gen, xine_cfg_entry_t *entry )
+{
+  crystalhd_video_decoder_t  *this  = (crystalhd_video_decoder_t *) this_gen;
+
+  /* the queue is created when the decoder is opened */
+  this->submit_queue_depth = entry->num_value;
+	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: submit_queue_depth %d\n", this->submit_queue_depth);
 }
 
 /*
@@ -670,17 +1047,66 @@ static video_decoder_t *crystalhd_video_open_plugin (video_decoder_class_t *clas
     _("due a bug in bcm70015 set this to true for bcm70015.\n"),
     10, crystalhd_decoder_reopen, this );
 
-  this->decoder_25p_drop = config->register_bool( config, "video.crystalhd_decoder.decoder_25p_drop", 0,
-    _("crystalhd_video: on >=50p drop every second frame"),
-    _("on >=50p drop every second frame. This is a hack for slow gfx cards.\n"),
-    10, crystalhd_decoder_25p_drop, this );
+  this->frame_drop = config->register_bool( config, "video.crystalhd_decoder.frame_drop", 1,
+    _("crystalhd_video: drop pictures the video output can't keep up with"),
+    _("While pictures are late, queue up or take longer to draw than their duration,\n"
+      "up to every second picture is dropped, late ones first. The full frame rate\n"
+      "comes back once the video output keeps up.\n"),
+    10, crystalhd_frame_drop, this );
+
+  this->h264_buffer_limit = config->register_range( config, "video.crystalhd_decoder.h264_buffer_limit", MAX_BUF_SIZE / 1024,
+    MIN_BUF_SIZE / 1024, MAX_BUF_SIZE / 1024,
+    _("crystalhd_video: h264 parser buffer limit in kB"),
+    _("The H.264 parser buffers grow on demand up to the cpb size of the stream's level,\n"
+      "but never beyond this size.\n"),
+    20, crystalhd_h264_buffer_limit, this );
+
+  this->submit_queue_depth = config->register_num( config, "video.crystalhd_decoder.submit_queue_depth", 8,
+    _("crystalhd_video: h264 submit queue depth"),
+    _("Number of H.264 access units which are queued for a separate thread feeding the decoder,\n"
+      "so a busy decoder does not block the parser. 0 sends them from the parser thread.\n"),
+    20, crystalhd_submit_queue_depth, this );
+
+  this->hugepage_buffers = config->register_bool( config, "video.crystalhd_decoder.hugepage_buffers", 0,
+    _("crystalhd_video: huge pages for picture buffers"),
+    _("Set this to true to back the decoded picture buffers with transparent huge pages.\n"),
+    20, crystalhd_hugepage_buffers, this );
+
+  this->direct_output = config->register_bool( config, "video.crystalhd_decoder.direct_output", 1,
+    _("crystalhd_video: receive pictures into the vo frames"),
+    _("With threading the decoder writes the pictures straight into the video output frames\n"
+      "instead of a buffer which is copied. Pictures are copied anyway if the video output\n"
+      "pads the lines.\n"),
+    20, crystalhd_direct_output, this );
+
+  this->output_format = config->register_enum( config, "video.crystalhd_decoder.output_format", OUTPUT_FORMAT_YUY2,
+    (char **)output_format_names,
+    _("crystalhd_video: picture format of the decoder"),
+    _("yuy2 is packed 4:2:2, yv12 has the decoder deliver 4:2:0, which moves 1.5 instead of\n"
+      "2 bytes per pixel but is always copied into the video output frames.\n"
+      "Applies when the decoder is started.\n"),
+    20, crystalhd_output_format, this );
+
+  this->render_workers = config->register_range( config, "video.crystalhd_decoder.render_workers", 2,
+    0, STRIPES_MAX_WORKERS,
+    _("crystalhd_video: threads copying the pictures"),
+    _("Pictures which are copied into the video output frames are split in stripes,\n"
+      "which this many threads copy besides the renderer. 0 copies on the renderer alone.\n"
+      "A change applies from the next picture.\n"),
+    20, crystalhd_render_workers, this );
 
 	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: scaling_enable %d\n", this->scaling_enable);
 	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: scaling_width  %d\n", this->scaling_width);
 	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: use_threading  %d\n", this->use_threading);
 	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: extra_logging  %d\n", this->extra_logging);
 	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: decoder_reopen %d\n", this->decoder_reopen);
-	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: decoder_25p_drop %d\n", this->decoder_25p_drop);
+	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: frame_drop %d\n", this->frame_drop);
+	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: h264_buffer_limit %d\n", this->h264_buffer_limit);
+	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: submit_queue_depth %d\n", this->submit_queue_depth);
+	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: hugepage_buffers %d\n", this->hugepage_buffers);
+	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: direct_output %d\n", this->direct_output);
+	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: output_format %d\n", this->output_format);
+	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: render_workers %d\n", this->render_workers);
 
   this->video_step  	    = 0;
   this->reported_video_step = 0;
@@ -689,10 +1115,10 @@ static video_decoder_t *crystalhd_video_open_plugin (video_decoder_class_t *clas
 
 	this->width							= 1920;
 	this->height						= 1082;
-	this->y_size						= this->width * this->height * 2;
-	this->uv_size						= 0;
 
 	this->interlaced        = 0;
+  this->picture_format    = (this->output_format == OUTPUT_FORMAT_YV12) ? XINE_IMGFMT_YV12 : XINE_IMGFMT_YUY2;
+  crystalhd_video_set_picture_size(this);
 	this->last_image				= 0;
 
 	this->rec_thread_stop 	= 0;
@@ -706,19 +1132,31 @@ static video_decoder_t *crystalhd_video_open_plugin (video_decoder_class_t *clas
 	crystalhd_vc1_init_sequence( &this->sequence_vc1 );
 
   this->nal_parser        = init_parser(this->xine);
+  set_parser_max_buf_size(this->nal_parser, (size_t)this->h264_buffer_limit * 1024);
+  /* the hardware does the reference handling itself */
+  set_parser_slice_parse_mode(this->nal_parser, SLICE_PARSE_BOUNDARY);
+  this->submit            = NULL;
+  if(this->submit_queue_depth > 0)
+    this->submit          = crystalhd_submit_create(this, this->submit_queue_depth);
   this->completed_pic     = NULL;
   this->extradata         = NULL;
   this->extradata_size    = 0;
   this->wait_for_frame_start = 0;
 
-	this->image_buffer      = xine_list_new();
+	this->image_ring        = crystalhd_ring_create(IMAGE_RING_SIZE);
+  this->frame_pool        = crystalhd_frame_pool_create(FRAME_POOL_SIZE, this->hugepage_buffers);
+  crystalhd_frame_pool_resize(this->frame_pool, this->y_size + this->uv_size);
+  crystalhd_rec_sched_init(&this->rec_sched);
+  crystalhd_render_sched_init(&this->render_sched);
+  crystalhd_decimate_init(&this->decimate);
+  this->stripes           = crystalhd_stripes_create(this->render_workers);
+  pthread_mutex_init(&this->render_mutex, NULL);
+  sem_init(&this->render_wake, 0, 0);
 
   this->set_form          = 0;
 
   this->reset             = VO_NEW_SEQUENCE_FLAG;
 
-  this->decoder_25p       = 0;
-
 	crystalhd_video_setup_workers(this);
 
   return &this->video_decoder;
@@ -50,6 +50,26 @@
 
 #include "cpb.h"
 #include "h264_parser.h"
+#include "crystalhd_submit.h"
+#include "crystalhd_rec.h"
+#include "crystalhd_ring.h"
+#include "crystalhd_pool.h"
+#include "crystalhd_render.h"
+#include "crystalhd_decimate.h"
+#include "crystalhd_yuv.h"
+#include "crystalhd_stripes.h"
+
+/* decoded pictures the receive thread may queue for the renderer */
+#define IMAGE_RING_SIZE 16
+/* picture buffers, the ring plus one being rendered and one being received */
+#define FRAME_POOL_SIZE (IMAGE_RING_SIZE + 2)
+/* vo frames the receive thread may hold with direct output, the vo driver
+ * needs the rest of its frames for the pictures on display */
+#define DIRECT_FRAMES_MAX 4
+
+/* video.crystalhd_decoder.output_format */
+#define OUTPUT_FORMAT_YUY2  0
+#define OUTPUT_FORMAT_YV12  1
 
 extern HANDLE hDevice;
 
@@ -64,6 +84,9 @@ typedef struct decoder_buffer_s {
 typedef struct image_buffer_s {
 	uint8_t		*image;
  	uint32_t	image_bytes;
+  /* the UV plane of a XINE_IMGFMT_YV12 picture, which the card delivers as NV12 */
+  uint8_t   *image_uv;
+  int       format;
 	int				width;
 	int				height;
 	uint64_t  pts;
@@ -73,6 +96,8 @@ typedef struct image_buffer_s {
 	int			  interlaced;
 	uint32_t	picture_number;
   uint32_t  stride;
+  /* the card wrote the picture straight into this frame, image is NULL */
+  vo_frame_t *vo_frame;
 } image_buffer_t;
 
 /* MGED Picture */
@@ -162,14 +187,6 @@ typedef struct {
   video_decoder_class_t   decoder_class;
 } crystalhd_video_class_t;
 
-struct buf_reader
-{
-  uint8_t *buf;
-  uint8_t *cur_pos;
-  int len;
-  int cur_offset;
-};
-
 typedef struct crystalhd_video_decoder_s {
 	video_decoder_t   video_decoder;  /* parent video decoder structure */
 
@@ -202,11 +219,29 @@ typedef struct crystalhd_video_decoder_s {
   int               have_frame_boundary_marks;
   int               wait_for_frame_start;
 
-	xine_list_t       *image_buffer;
+  /* decoded pictures from the receive thread to the renderer */
+	frame_ring_t      *image_ring;
+  /* the picture buffers of image_ring */
+  frame_pool_t      *frame_pool;
 
 	pthread_t         rec_thread;
 	int								rec_thread_stop;
-	pthread_mutex_t		rec_mutex;
+  struct rec_sched  rec_sched;
+
+  /* draws the pictures of image_ring when they are due. render_mutex is
+   * held while taking pictures from the ring and for the scheduler, the
+   * decimator and reset, but not while drawing. render_wake is posted by
+   * the receive thread for every new picture */
+  pthread_t         render_thread;
+  int               render_thread_stop;
+  pthread_mutex_t   render_mutex;
+  sem_t             render_wake;
+  struct render_sched render_sched;
+  /* counts new sequences, a picture drawn across one is not accounted */
+  uint32_t          render_sequence;
+  /* drops pictures while the video output falls behind, used by the
+   * renderer only */
+  struct decimate   decimate;
 
   int               set_form;
 
@@ -220,8 +255,27 @@ typedef struct crystalhd_video_decoder_s {
   int               use_threading;
   int               extra_logging;
   int               decoder_reopen;
-  int               decoder_25p;
-  int               decoder_25p_drop;
+  int               frame_drop;
+  int               h264_buffer_limit;
+  /* h264 access units are sent by a thread through this queue,
+   * NULL if submit_queue_depth is 0 */
+  crystalhd_submit_t *submit;
+  int               submit_queue_depth;
+  int               hugepage_buffers;
+  int               direct_output;
+  int               output_format;
+  /* threads copying the stripes of a picture besides the renderer,
+   * NULL if render_workers is 0 */
+  stripe_pool_t     *stripes;
+  int               render_workers;
+  /* set under render_mutex when render_workers changed, the renderer
+   * replaces the pool before its next picture */
+  int               stripes_changed;
+  /* XINE_IMGFMT_ of the pictures, from output_format when the decoder was started */
+  int               picture_format;
+  /* pictures received into vo frames and into transfer buffers */
+  uint64_t          direct_frames;
+  uint64_t          copied_frames;
 } crystalhd_video_decoder_t;
 
 typedef uint32_t BCM_STREAM_TYPE;
@@ -230,5 +284,6 @@ typedef uint32_t BCM_VIDEO_ALGO;
 void *crystalhd_video_rec_thread (void *this_gen);
 void crystalhd_decode_package (uint8_t *buf, uint32_t size);
 void set_video_params (crystalhd_video_decoder_t *this);
+void crystalhd_video_set_picture_size (crystalhd_video_decoder_t *this);
 
 #endif
@@ -28,7 +28,16 @@
  * crystalhd_h264 specific decode functions
  *************************************************************************/
 
+static void crystalhd_h264_log_parser (crystalhd_video_decoder_t *this) {
+  struct h264_parser *parser = this->nal_parser;
+
+	xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_video: h264 parser memory %u bytes, "
+      "pool high water %u nal units %u pictures\n",
+      parser_buf_memory(parser), parser->nal_pool->high_water, parser->pic_pool->high_water);
+}
+
 void crystalhd_h264_free_parser (crystalhd_video_decoder_t *this) {
+  crystalhd_h264_log_parser(this);
   if(this->completed_pic) {
     free_coded_picture(this->completed_pic);
     this->completed_pic = NULL;
@@ -37,6 +46,16 @@ void crystalhd_h264_free_parser (crystalhd_video_decoder_t *this) {
   this->nal_parser = NULL;
 }
 
+/* keeps the parser and its buffers, only the stream state is dropped */
+void crystalhd_h264_reset_parser (crystalhd_video_decoder_t *this) {
+  if(this->completed_pic) {
+    free_coded_picture(this->completed_pic);
+    this->completed_pic = NULL;
+  }
+  reset_parser(this->nal_parser);
+  crystalhd_h264_log_parser(this);
+}
+
 /*
  * This function receives a buffer of data from the demuxer layer and
  * figures out how to handle it based on its header flags.
@@ -96,15 +115,15 @@ void crystalhd_h264_decode_data (video_decoder_t *this_gen,
 
       if(this->completed_pic &&
           this->completed_pic->sps_nal != NULL &&
-          this->completed_pic->sps_nal->sps.pic_width > 0 &&
-          this->completed_pic->sps_nal->sps.pic_height > 0) {
+          this->completed_pic->sps_nal->sps->pic_width > 0 &&
+          this->completed_pic->sps_nal->sps->pic_height > 0) {
         
         if(!this->set_form) {
           hDevice = crystalhd_start(this, hDevice, BC_STREAM_TYPE_ES, BC_VID_ALGO_H264, 0, NULL, 0, 0, 0,
               this->scaling_enable, this->scaling_width);
           this->set_form = 1;
 
-          struct seq_parameter_set_rbsp *sps = &this->completed_pic->sps_nal->sps;
+          struct seq_parameter_set_rbsp *sps = this->completed_pic->sps_nal->sps;
 
           if(sps->vui_parameters_present_flag &&
               sps->vui_parameters.timing_info_present_flag ) {
@@ -118,14 +137,24 @@ void crystalhd_h264_decode_data (video_decoder_t *this_gen,
           this->last_pts = this->completed_pic->pts;
         }
 
-        crystalhd_send_data(this, hDevice, decode_buffer.bytestream, decode_buffer.bytestream_bytes, this->last_pts);
+        if(this->submit) {
+          /* the queue keeps the access unit buffer and the parser
+           * gets a free buffer of the queue in exchange */
+          uint8_t *au_buf = NULL;
+          uint32_t au_size = 0;
+
+          parser_swap_outbuf(this->nal_parser, &au_buf, &au_size);
+          crystalhd_submit_push(this->submit, &au_buf, &au_size,
+              decode_buffer.bytestream_bytes, this->last_pts);
+          parser_swap_outbuf(this->nal_parser, &au_buf, &au_size);
+        } else {
+          crystalhd_send_data(this, hDevice, decode_buffer.bytestream, decode_buffer.bytestream_bytes, this->last_pts);
+        }
 
       }
         
-      if(decode_buffer.bytestream_bytes > 0) {
-        free(decode_buffer.bytestream);
-        decode_buffer.bytestream_bytes = 0;
-      }
+      /* the bytestream is owned by the parser */
+      decode_buffer.bytestream_bytes = 0;
 
       if(this->completed_pic) {
         free_coded_picture(this->completed_pic);
@@ -182,6 +182,10 @@ HANDLE crystalhd_start (crystalhd_video_decoder_t *this, HANDLE hDevice, BCM_STR
     xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_start: stream_type %d\n", stream_type);
     xprintf(this->xine, XINE_VERBOSITY_LOG, "crystalhd_start: algo %d\n", algo);
 
+    /* the submit thread must not use the device while it is restarted */
+    if(this->submit)
+      crystalhd_submit_drain(this->submit);
+
   	hDevice = crystalhd_stop (this, hDevice);
 
     if(this->decoder_reopen) {
@@ -229,9 +233,14 @@ HANDLE crystalhd_start (crystalhd_video_decoder_t *this, HANDLE hDevice, BCM_STR
      	}
     }
 
-   	res = DtsSetColorSpace(hDevice, OUTPUT_MODE422_YUY2);
+    /* 4:2:0 comes as NV12 and takes 1.5 bytes per pixel instead of 2 */
+    this->picture_format = (this->output_format == OUTPUT_FORMAT_YV12) ? XINE_IMGFMT_YV12 : XINE_IMGFMT_YUY2;
+    crystalhd_video_set_picture_size(this);
+    crystalhd_frame_pool_resize(this->frame_pool, this->y_size + this->uv_size);
+   	res = DtsSetColorSpace(hDevice, (this->picture_format == XINE_IMGFMT_YV12) ? OUTPUT_MODE420 : OUTPUT_MODE422_YUY2);
    	if (res != BC_STS_SUCCESS) {
-   		xprintf(this->xine, XINE_VERBOSITY_LOG,"crystalhd: Failed to set 422 mode\n");
+   		xprintf(this->xine, XINE_VERBOSITY_LOG,"crystalhd: Failed to set %s mode\n",
+          (this->picture_format == XINE_IMGFMT_YV12) ? "420" : "422");
    	}
 
   	res = DtsOpenDecoder(hDevice, stream_type);
@@ -26,6 +26,7 @@
 #include "crystalhd_hw.h"
 #include "crystalhd_mpeg.h"
 #include "bits_reader.h"
+#include "startcode.h"
 
 #define sequence_header_code    0xb3
 #define sequence_error_code     0xb4
@@ -187,12 +188,12 @@ void mpeg_sequence_header( crystalhd_video_decoder_t *this, uint8_t *buf, int le
   i = read_bits( &sequence->br, 1 );
   lprintf( "load_intra_quantizer_matrix: %d\n", i );
   if ( i ) {
-    read_bits( &sequence->br, 8 * 64 );
+    skip_bits_long( &sequence->br, 8 * 64 );
   } 
   i = read_bits( &sequence->br, 1 );
   lprintf( "load_non_intra_quantizer_matrix: %d\n", i );
   if ( i ) {
-    read_bits( &sequence->br, 8 * 64 );
+    skip_bits_long( &sequence->br, 8 * 64 );
   }
    
   if ( !sequence->have_header ) {
@@ -450,25 +451,28 @@ void crystalhd_mpeg_decode_data (video_decoder_t *this_gen,
   xine_fast_memcpy( seq->buf+seq->bufpos, buf->content, buf->size );
   seq->bufpos += buf->size;
 
-  while ( seq->bufseek <= seq->bufpos-4 ) {
-    uint8_t *buffer = seq->buf+seq->bufseek;
-    if ( buffer[0]==0 && buffer[1]==0 && buffer[2]==1 ) {
-      if ( seq->start<0 ) {
-        seq->start = seq->bufseek;
-      }
-      else {
-        if ( mpeg_parse_code( this, seq->buf+seq->start, seq->bufseek-seq->start ) ) {
-          mpeg_decode_picture( this, 0 );
-          mpeg_parse_code( this, seq->buf+seq->start, seq->bufseek-seq->start );
-        }
-        uint8_t *tmp = (uint8_t*)malloc(seq->bufsize);
-        xine_fast_memcpy( tmp, seq->buf+seq->bufseek, seq->bufpos-seq->bufseek );
-        seq->bufpos -= seq->bufseek;
-        seq->start = -1;
-        seq->bufseek = -1;
-        free( seq->buf );
-        seq->buf = tmp;
+  while ( seq->bufseek+4 <= (int)seq->bufpos ) {
+    int next = find_start_code( seq->buf+seq->bufseek, seq->bufpos-seq->bufseek-1 );
+    if ( next<0 ) {
+      seq->bufseek = seq->bufpos-3;
+      break;
+    }
+    seq->bufseek += next;
+    if ( seq->start<0 ) {
+      seq->start = seq->bufseek;
+    }
+    else {
+      if ( mpeg_parse_code( this, seq->buf+seq->start, seq->bufseek-seq->start ) ) {
+        mpeg_decode_picture( this, 0 );
+        mpeg_parse_code( this, seq->buf+seq->start, seq->bufseek-seq->start );
       }
+      uint8_t *tmp = (uint8_t*)malloc(seq->bufsize);
+      xine_fast_memcpy( tmp, seq->buf+seq->bufseek, seq->bufpos-seq->bufseek );
+      seq->bufpos -= seq->bufseek;
+      seq->start = -1;
+      seq->bufseek = -1;
+      free( seq->buf );
+      seq->buf = tmp;
     }
     ++seq->bufseek;
   }
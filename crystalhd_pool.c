@@ -0,0 +1,168 @@
+/*
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * crystalhd_pool.c: recycled, page aligned picture transfer buffers
+ *
+ * A 1080p YUY2 picture is about 4 MB, which malloc serves with mmap, so
+ * every picture used to fault in a thousand fresh pages and give them back
+ * to the kernel on free. The pool maps each buffer once, touches all of
+ * its pages, and hands it around between the receive thread and the
+ * renderer until the picture size changes.
+ *
+ * Each mapping starts with one page holding the buffer header, the buffer
+ * itself follows page aligned.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "crystalhd_pool.h"
+
+struct frame_pool_header {
+  size_t    map_len;
+  uint32_t  size;
+};
+
+static size_t page_size(void) {
+  static size_t size;
+
+  if(!size)
+    size = sysconf(_SC_PAGESIZE);
+  return size;
+}
+
+static struct frame_pool_header *buf_header(uint8_t *buf) {
+  return (struct frame_pool_header *)(buf - page_size());
+}
+
+static uint8_t *frame_pool_map(frame_pool_t *pool, uint32_t size) {
+  size_t page = page_size();
+  size_t map_len = page + ((size + page - 1) & ~(page - 1));
+  struct frame_pool_header *header;
+  uint8_t *base;
+  size_t i;
+
+  base = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(base == MAP_FAILED)
+    return NULL;
+
+#ifdef MADV_HUGEPAGE
+  if(pool->hugepages)
+    madvise(base, map_len, MADV_HUGEPAGE);
+#endif
+
+  /* prefault, the card and the renderer should not take the faults */
+  for(i = 0; i < map_len; i += page)
+    base[i] = 0;
+
+  header = (struct frame_pool_header *)base;
+  header->map_len = map_len;
+  header->size = size;
+
+  pool->allocated++;
+  pool->stats.allocs++;
+
+  return base + page;
+}
+
+static void frame_pool_unmap(frame_pool_t *pool, uint8_t *buf) {
+  struct frame_pool_header *header = buf_header(buf);
+
+  munmap(header, header->map_len);
+
+  pool->allocated--;
+  pool->stats.frees++;
+}
+
+frame_pool_t *crystalhd_frame_pool_create(uint32_t max_buffers, int hugepages) {
+  frame_pool_t *pool = calloc(1, sizeof(frame_pool_t));
+
+  pool->free_bufs = calloc(max_buffers, sizeof(uint8_t *));
+  pool->max_buffers = max_buffers;
+  pool->hugepages = hugepages;
+
+  pthread_mutex_init(&pool->mutex, NULL);
+
+  return pool;
+}
+
+void crystalhd_frame_pool_free(frame_pool_t *pool) {
+  uint32_t i;
+
+  for(i = 0; i < pool->free_count; i++)
+    frame_pool_unmap(pool, pool->free_bufs[i]);
+
+  pthread_mutex_destroy(&pool->mutex);
+  free(pool->free_bufs);
+  free(pool);
+}
+
+void crystalhd_frame_pool_resize(frame_pool_t *pool, uint32_t size) {
+  uint32_t i;
+
+  pthread_mutex_lock(&pool->mutex);
+
+  if(size != pool->buf_size) {
+    for(i = 0; i < pool->free_count; i++)
+      frame_pool_unmap(pool, pool->free_bufs[i]);
+    pool->free_count = 0;
+    pool->buf_size = size;
+    pool->stats.resizes++;
+  }
+
+  pthread_mutex_unlock(&pool->mutex);
+}
+
+uint8_t *crystalhd_frame_pool_get(frame_pool_t *pool) {
+  uint8_t *buf = NULL;
+
+  pthread_mutex_lock(&pool->mutex);
+
+  if(pool->free_count) {
+    buf = pool->free_bufs[--pool->free_count];
+    pool->stats.reuses++;
+  } else if(pool->buf_size) {
+    if(pool->allocated < pool->max_buffers)
+      buf = frame_pool_map(pool, pool->buf_size);
+    else
+      pool->stats.exhausted++;
+  }
+
+  pthread_mutex_unlock(&pool->mutex);
+
+  return buf;
+}
+
+void crystalhd_frame_pool_put(frame_pool_t *pool, uint8_t *buf) {
+  if(!buf)
+    return;
+
+  pthread_mutex_lock(&pool->mutex);
+
+  if(buf_header(buf)->size == pool->buf_size && pool->free_count < pool->max_buffers)
+    pool->free_bufs[pool->free_count++] = buf;
+  else
+    frame_pool_unmap(pool, buf);
+
+  pthread_mutex_unlock(&pool->mutex);
+}
+
+uint32_t crystalhd_frame_pool_buf_size(uint8_t *buf) {
+  return buf_header(buf)->size;
+}
@@ -0,0 +1,72 @@
+/*
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * crystalhd_pool.h: recycled, page aligned picture transfer buffers
+ */
+
+#ifndef CRYSTALHD_POOL_H
+#define CRYSTALHD_POOL_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+struct frame_pool_stats {
+  /* buffers mapped and unmapped */
+  uint64_t  allocs;
+  uint64_t  frees;
+  /* gets served from the free list */
+  uint64_t  reuses;
+  /* gets refused because max_buffers were out */
+  uint64_t  exhausted;
+  uint32_t  resizes;
+};
+
+typedef struct frame_pool_s {
+  pthread_mutex_t   mutex;
+
+  /* buffers of buf_size which are not in use */
+  uint8_t   **free_bufs;
+  uint32_t  free_count;
+
+  uint32_t  max_buffers;
+  /* buffers in use and in the free list, of any size */
+  uint32_t  allocated;
+  uint32_t  buf_size;
+  int       hugepages;
+
+  struct frame_pool_stats stats;
+} frame_pool_t;
+
+/* at most max_buffers are out at any time. with hugepages the buffers are
+ * advised for transparent huge pages. */
+frame_pool_t *crystalhd_frame_pool_create(uint32_t max_buffers, int hugepages);
+/* all buffers must have been put back */
+void crystalhd_frame_pool_free(frame_pool_t *pool);
+
+/* following gets return buffers of size bytes. buffers of the former size
+ * are released as they come back */
+void crystalhd_frame_pool_resize(frame_pool_t *pool, uint32_t size);
+
+/* a prefaulted buffer of the current size, NULL if none is free and
+ * max_buffers are out or the size is not known yet */
+uint8_t *crystalhd_frame_pool_get(frame_pool_t *pool);
+void crystalhd_frame_pool_put(frame_pool_t *pool, uint8_t *buf);
+
+/* the size buf was made for, which is not the current one after a resize */
+uint32_t crystalhd_frame_pool_buf_size(uint8_t *buf);
+
+#endif
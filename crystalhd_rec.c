@@ -0,0 +1,136 @@
+/*
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * crystalhd_rec.c: decides when the receive thread polls the hardware
+ * for decoded pictures, and how long it waits
+ *
+ * While pictures come in, the next one is due one frame period after the
+ * last. The thread sleeps until half a period before that and then blocks
+ * in DtsProcOutput, so a picture is taken as soon as the card has it and a
+ * late dequeue does not shift the following ones. Without pictures for a
+ * few periods (paused, prebuffering, flushed) it sleeps with an increasing
+ * interval instead.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "crystalhd_rec.h"
+
+int64_t crystalhd_rec_now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void crystalhd_rec_sched_init(struct rec_sched *sched) {
+  memset(sched, 0, sizeof(struct rec_sched));
+}
+
+static uint32_t us_to_ms(int64_t us) {
+  /* round up, a too short wait only costs another wakeup */
+  return us > 1000 ? (uint32_t)((us + 999) / 1000) : 1;
+}
+
+enum rec_action crystalhd_rec_sched_next(struct rec_sched *sched, uint32_t video_step,
+    uint32_t ready_count, int64_t now_us, uint32_t *wait_ms) {
+
+  int64_t period_us = video_step ? (int64_t)video_step * 100 / 9 : REC_DEFAULT_PERIOD_US;
+  int64_t due_us = sched->last_frame_us + period_us;
+
+  sched->stats.wakeups++;
+
+  if(ready_count) {
+    if(!sched->ready_seen_us)
+      sched->ready_seen_us = now_us;
+    sched->idle_ms = 0;
+    sched->stats.dequeues++;
+    *wait_ms = us_to_ms(period_us);
+    return REC_DEQUEUE;
+  }
+
+  if(!sched->last_frame_us || now_us - sched->last_frame_us > REC_IDLE_PERIODS * period_us) {
+    sched->idle_ms = sched->idle_ms ? sched->idle_ms * 2 : 1;
+    if(sched->idle_ms > REC_IDLE_MAX_MS)
+      sched->idle_ms = REC_IDLE_MAX_MS;
+    sched->stats.sleeps++;
+    *wait_ms = sched->idle_ms;
+    return REC_SLEEP;
+  }
+
+  if(now_us < due_us - period_us / 2) {
+    sched->stats.sleeps++;
+    *wait_ms = us_to_ms(due_us - period_us / 2 - now_us);
+    return REC_SLEEP;
+  }
+
+  /* due, wait for it up to one more period */
+  sched->stats.dequeues++;
+  *wait_ms = us_to_ms(due_us + period_us - now_us);
+  return REC_DEQUEUE;
+}
+
+void crystalhd_rec_sched_frame(struct rec_sched *sched, int64_t ready_us, int64_t now_us) {
+  if(!ready_us)
+    ready_us = sched->ready_seen_us ? sched->ready_seen_us : now_us;
+
+  crystalhd_rec_latency_add(&sched->stats.latency, now_us - ready_us);
+
+  sched->last_frame_us = now_us;
+  sched->ready_seen_us = 0;
+  sched->idle_ms = 0;
+}
+
+void crystalhd_rec_sched_miss(struct rec_sched *sched) {
+  sched->stats.misses++;
+}
+
+void crystalhd_rec_latency_add(struct rec_latency *latency, int64_t us) {
+  int bin = 0;
+
+  if(us < 0)
+    us = 0;
+
+  while(bin < REC_LATENCY_BINS - 1 && us >= ((int64_t)REC_LATENCY_BIN0_US << bin))
+    bin++;
+
+  latency->bins[bin]++;
+  latency->frames++;
+  latency->sum_us += us;
+  if(us > latency->max_us)
+    latency->max_us = us;
+}
+
+void crystalhd_rec_latency_format(struct rec_latency *latency, char *buf, size_t len) {
+  int n, i;
+
+  n = snprintf(buf, len, "%llu frames, mean %.2f ms max %.2f ms |",
+      (unsigned long long)latency->frames,
+      latency->frames ? latency->sum_us / 1000.0 / latency->frames : 0.0,
+      latency->max_us / 1000.0);
+
+  for(i = 0; i < REC_LATENCY_BINS && n > 0 && (size_t)n < len; i++) {
+    if(i < REC_LATENCY_BINS - 1)
+      n += snprintf(buf + n, len - n, " <%g:%u",
+          (REC_LATENCY_BIN0_US << i) / 1000.0, latency->bins[i]);
+    else
+      n += snprintf(buf + n, len - n, " >=%g:%u",
+          (REC_LATENCY_BIN0_US << (i - 1)) / 1000.0, latency->bins[i]);
+  }
+}
@@ -0,0 +1,92 @@
+/*
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * crystalhd_rec.h: decides when the receive thread polls the hardware
+ * for decoded pictures, and how long it waits
+ */
+
+#ifndef CRYSTALHD_REC_H
+#define CRYSTALHD_REC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* frame period assumed while the stream did not tell us one (25 fps) */
+#define REC_DEFAULT_PERIOD_US   40000
+/* the receive loop goes idle when no picture came for that many periods */
+#define REC_IDLE_PERIODS        2
+/* longest sleep while idle, the idle sleep doubles from 1 ms up to it */
+#define REC_IDLE_MAX_MS         64
+
+/* latency histogram, bin 0 is < 250 us and every next bin doubles,
+ * the last one takes everything above 64 ms */
+#define REC_LATENCY_BINS        10
+#define REC_LATENCY_BIN0_US     250
+
+struct rec_latency {
+  uint32_t  bins[REC_LATENCY_BINS];
+  uint64_t  frames;
+  uint64_t  sum_us;
+  uint32_t  max_us;
+};
+
+struct rec_stats {
+  /* ready to dequeued latency of every picture */
+  struct rec_latency latency;
+  /* loop iterations, each one is a wakeup of the receive thread */
+  uint64_t  wakeups;
+  uint64_t  sleeps;
+  uint64_t  dequeues;
+  /* dequeues which did not return a picture */
+  uint64_t  misses;
+};
+
+enum rec_action {
+  REC_DEQUEUE,  /* block in DtsProcOutput for at most wait_ms */
+  REC_SLEEP     /* nothing is due, sleep wait_ms */
+};
+
+struct rec_sched {
+  /* when the last picture was dequeued, 0 before the first one */
+  int64_t   last_frame_us;
+  /* when the loop first saw the ready list non empty, 0 if it did not */
+  int64_t   ready_seen_us;
+  uint32_t  idle_ms;
+
+  struct rec_stats stats;
+};
+
+int64_t crystalhd_rec_now(void);
+
+void crystalhd_rec_sched_init(struct rec_sched *sched);
+
+/* what to do next, from the frame duration (in 90 kHz ticks, 0 if unknown)
+ * and the ready list count of the driver */
+enum rec_action crystalhd_rec_sched_next(struct rec_sched *sched, uint32_t video_step,
+    uint32_t ready_count, int64_t now_us, uint32_t *wait_ms);
+
+/* a picture was dequeued. ready_us is when it became ready, 0 takes the
+ * time the loop first saw it in the ready list */
+void crystalhd_rec_sched_frame(struct rec_sched *sched, int64_t ready_us, int64_t now_us);
+/* a dequeue returned no picture */
+void crystalhd_rec_sched_miss(struct rec_sched *sched);
+
+void crystalhd_rec_latency_add(struct rec_latency *latency, int64_t us);
+/* one line summary of the histogram */
+void crystalhd_rec_latency_format(struct rec_latency *latency, char *buf, size_t len);
+
+#endif
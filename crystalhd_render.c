@@ -0,0 +1,168 @@
+/*
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * crystalhd_render.c: decides when the render thread hands the queued
+ * pictures to the video output
+ *
+ * The metronom turns the pts of a drawn picture into the vpts it is shown
+ * at. The difference is kept, so the vpts of the queued pictures can be
+ * guessed and compared to the clock. A picture is drawn once it is shown
+ * within RENDER_LEAD_PERIODS frames, which leaves the video output enough
+ * pictures to show, and all pictures beyond RENDER_MAX_BACKLOG are drawn
+ * at once so the backlog can't grow. Until the first picture was drawn,
+ * and after a pts jump, pictures are drawn as they come.
+ *
+ * A picture whose display time has passed is dropped by the video output
+ * after all the work of copying it. It goes to the video output as a bad
+ * frame without the copy while the last draw asked for frames to be
+ * skipped, or if it is hopelessly late, so the metronom still counts it.
+ * Every RENDER_SKIP_MAX_RUN pictures one is drawn anyway, so a wrong guess
+ * can't hold back all of them.
+ */
+
+#include <string.h>
+
+#include "crystalhd_render.h"
+
+void crystalhd_render_sched_init(struct render_sched *sched) {
+  memset(sched, 0, sizeof(struct render_sched));
+}
+
+void crystalhd_render_sched_reset(struct render_sched *sched) {
+  sched->have_offset = 0;
+  sched->last_pts = 0;
+  sched->vo_skip = 0;
+  sched->skip_run = 0;
+}
+
+static uint32_t ticks_to_ms(int64_t ticks) {
+  /* round up, a too short wait only costs another wakeup */
+  return ticks > 90 ? (uint32_t)((ticks + 89) / 90) : 1;
+}
+
+int crystalhd_render_sched_next(struct render_sched *sched, uint32_t queued,
+    int64_t pts, uint32_t video_step, int64_t now_vpts, uint32_t *wait_ms) {
+
+  struct render_stats *stats = &sched->stats;
+  int64_t step = video_step ? video_step : RENDER_DEFAULT_STEP;
+  int64_t ahead;
+
+  sched->backlog = queued;
+  sched->backlog_ms = queued * step / 90;
+
+  if(!queued) {
+    *wait_ms = ticks_to_ms(step);
+    if(*wait_ms > RENDER_IDLE_MAX_MS)
+      *wait_ms = RENDER_IDLE_MAX_MS;
+    return 0;
+  }
+
+  stats->samples++;
+  stats->backlog_sum += sched->backlog;
+  stats->backlog_ms_sum += sched->backlog_ms;
+  if(sched->backlog > stats->max_backlog)
+    stats->max_backlog = sched->backlog;
+  if(sched->backlog_ms > stats->max_backlog_ms)
+    stats->max_backlog_ms = sched->backlog_ms;
+
+  if(!sched->have_offset || queued > RENDER_MAX_BACKLOG) {
+    stats->forced++;
+    return 1;
+  }
+
+  if(!pts)
+    pts = sched->last_pts + step;
+
+  ahead = pts + sched->vpts_offset - now_vpts - RENDER_LEAD_PERIODS * step;
+  if(ahead <= 0)
+    return 1;
+
+  if(ahead > RENDER_MAX_AHEAD) {
+    sched->have_offset = 0;
+    stats->forced++;
+    return 1;
+  }
+
+  *wait_ms = ticks_to_ms(ahead);
+  if(*wait_ms > RENDER_IDLE_MAX_MS)
+    *wait_ms = RENDER_IDLE_MAX_MS;
+  return 0;
+}
+
+static int64_t sched_pts(struct render_sched *sched, int64_t pts, uint32_t video_step) {
+  return pts ? pts : sched->last_pts + (video_step ? video_step : RENDER_DEFAULT_STEP);
+}
+
+void crystalhd_render_sched_drawn(struct render_sched *sched, int64_t pts,
+    uint32_t video_step, int64_t vpts) {
+
+  pts = sched_pts(sched, pts, video_step);
+
+  if(vpts) {
+    sched->vpts_offset = vpts - pts;
+    sched->have_offset = 1;
+  }
+
+  sched->last_pts = pts;
+  sched->skip_run = 0;
+  sched->stats.drawn++;
+}
+
+void crystalhd_render_sched_dropped(struct render_sched *sched, int64_t pts,
+    uint32_t video_step) {
+  sched->last_pts = sched_pts(sched, pts, video_step);
+}
+
+int64_t crystalhd_render_sched_late(struct render_sched *sched, int64_t pts,
+    uint32_t video_step, int64_t now_vpts) {
+
+  if(!sched->have_offset)
+    return 0;
+
+  return now_vpts - (sched_pts(sched, pts, video_step) + sched->vpts_offset);
+}
+
+int crystalhd_render_sched_skip(struct render_sched *sched, int64_t pts,
+    uint32_t video_step, int64_t now_vpts, int copy) {
+
+  int64_t step = video_step ? video_step : RENDER_DEFAULT_STEP;
+  int64_t late = crystalhd_render_sched_late(sched, pts, video_step, now_vpts);
+
+  if(late <= 0) {
+    /* caught up, the skip request is stale */
+    sched->vo_skip = 0;
+    return 0;
+  }
+
+  if(sched->skip_run >= RENDER_SKIP_MAX_RUN ||
+      (!sched->vo_skip && late <= RENDER_HOPELESS_PERIODS * step))
+    return 0;
+
+  if(sched->vo_skip)
+    sched->vo_skip--;
+  sched->skip_run++;
+  if(copy)
+    sched->stats.skipped_before_copy++;
+  crystalhd_render_sched_dropped(sched, pts, video_step);
+  return 1;
+}
+
+void crystalhd_render_sched_vo_skip(struct render_sched *sched, int frames) {
+  sched->vo_skip = (frames > 0) ? frames : 0;
+  if(frames > 0)
+    sched->stats.skipped_after_copy++;
+}
@@ -0,0 +1,111 @@
+/*
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * crystalhd_render.h: decides when the render thread hands the queued
+ * pictures to the video output
+ */
+
+#ifndef CRYSTALHD_RENDER_H
+#define CRYSTALHD_RENDER_H
+
+#include <stdint.h>
+
+/* frame duration assumed while the stream did not tell us one (25 fps) */
+#define RENDER_DEFAULT_STEP     3600
+/* pictures are drawn that many frame periods before they are displayed */
+#define RENDER_LEAD_PERIODS     4
+/* more queued pictures than this are drawn whether they are due or not */
+#define RENDER_MAX_BACKLOG      4
+/* a picture due later than this (90 kHz) means the pts jumped, the clock
+ * mapping is learned again from it */
+#define RENDER_MAX_AHEAD        90000
+/* longest wait of the render thread */
+#define RENDER_IDLE_MAX_MS      40
+/* a picture shown that many frame periods ago is released without a copy */
+#define RENDER_HOPELESS_PERIODS 2
+/* most pictures in a row released without a copy, then one is drawn */
+#define RENDER_SKIP_MAX_RUN     8
+
+struct render_stats {
+  uint64_t  drawn;
+  /* pictures drawn before they were due, because the backlog was too long
+   * or the clock mapping was not known */
+  uint64_t  forced;
+  /* backlog seen by every decision with pictures queued */
+  uint64_t  samples;
+  uint64_t  backlog_sum;
+  uint64_t  backlog_ms_sum;
+  uint32_t  max_backlog;
+  uint32_t  max_backlog_ms;
+  /* late pictures released without a copy, and pictures drawn anyway which
+   * the video output answered with a skip request */
+  uint64_t  skipped_before_copy;
+  uint64_t  skipped_after_copy;
+};
+
+struct render_sched {
+  /* vpts minus pts of the last drawn picture, valid if have_offset */
+  int64_t   vpts_offset;
+  int       have_offset;
+  /* pts of the last drawn picture, pictures without one follow it */
+  int64_t   last_pts;
+
+  /* the backlog of the last decision, in pictures and in milliseconds */
+  uint32_t  backlog;
+  uint32_t  backlog_ms;
+
+  /* frames the video output asked to skip at the last draw, and the late
+   * pictures released in a row since */
+  int       vo_skip;
+  int       skip_run;
+
+  struct render_stats stats;
+};
+
+void crystalhd_render_sched_init(struct render_sched *sched);
+/* forget the clock mapping, after a flush or a discontinuity */
+void crystalhd_render_sched_reset(struct render_sched *sched);
+
+/* whether the oldest of queued pictures is drawn now. pts is its pts (0 if
+ * it has none), video_step the frame duration (0 if unknown) and now_vpts
+ * the metronom clock. if it is not due yet wait_ms is set to the time until
+ * it is, or the idle wait if nothing is queued. */
+int crystalhd_render_sched_next(struct render_sched *sched, uint32_t queued,
+    int64_t pts, uint32_t video_step, int64_t now_vpts, uint32_t *wait_ms);
+
+/* the picture was drawn, vpts is what the metronom gave it (0 if none) */
+void crystalhd_render_sched_drawn(struct render_sched *sched, int64_t pts,
+    uint32_t video_step, int64_t vpts);
+/* the picture was dropped, it went to the video output as a bad frame */
+void crystalhd_render_sched_dropped(struct render_sched *sched, int64_t pts,
+    uint32_t video_step);
+
+/* whether a picture is released without a copy, because its display time
+ * has passed and the video output asked to skip frames or it is more than
+ * RENDER_HOPELESS_PERIODS late. copy is set if it would have been copied,
+ * a picture the card wrote into a vo frame saves nothing and isn't counted */
+int crystalhd_render_sched_skip(struct render_sched *sched, int64_t pts,
+    uint32_t video_step, int64_t now_vpts, int copy);
+/* frames is what the draw of the last picture returned */
+void crystalhd_render_sched_vo_skip(struct render_sched *sched, int frames);
+
+/* how long (90 kHz) the display time of a picture has passed at now_vpts,
+ * not above 0 if it hasn't or the clock mapping is not known */
+int64_t crystalhd_render_sched_late(struct render_sched *sched, int64_t pts,
+    uint32_t video_step, int64_t now_vpts);
+
+#endif
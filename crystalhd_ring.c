@@ -0,0 +1,117 @@
+/*
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * crystalhd_ring.c: single producer, single consumer ring of decoded
+ * pictures between the receive thread and the renderer
+ *
+ * head and tail run freely and are masked on access. The producer fills a
+ * slot and then publishes it with a release store of head, the consumer
+ * reads head with acquire before it touches the slot, and the same pairing
+ * on tail hands the slot back.
+ */
+
+#include "crystalhd_decoder.h"
+#include "crystalhd_ring.h"
+
+frame_ring_t *crystalhd_ring_create(uint32_t capacity) {
+  frame_ring_t *ring = calloc(1, sizeof(frame_ring_t));
+  uint32_t size = 1;
+
+  while(size < capacity)
+    size <<= 1;
+
+  ring->capacity = size;
+  ring->mask = size - 1;
+  ring->slots = calloc(size, sizeof(image_buffer_t));
+
+  return ring;
+}
+
+void crystalhd_ring_free(frame_ring_t *ring) {
+  free(ring->slots);
+  free(ring);
+}
+
+int crystalhd_ring_full(frame_ring_t *ring) {
+  uint32_t head = ring->head;
+
+  if(head - ring->cached_tail < ring->capacity)
+    return 0;
+
+  ring->cached_tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+  return head - ring->cached_tail == ring->capacity;
+}
+
+int crystalhd_ring_push(frame_ring_t *ring, const image_buffer_t *img) {
+  uint32_t head = ring->head;
+  uint32_t depth;
+
+  if(crystalhd_ring_full(ring)) {
+    ring->producer.full++;
+    return 0;
+  }
+
+  ring->slots[head & ring->mask] = *img;
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+  depth = head + 1 - ring->cached_tail;
+  ring->producer.pushed++;
+  ring->producer.depth_sum += depth;
+  if(depth > ring->producer.max_depth)
+    ring->producer.max_depth = depth;
+
+  return 1;
+}
+
+static uint32_t crystalhd_ring_available(frame_ring_t *ring) {
+  uint32_t tail = ring->tail;
+
+  if(ring->cached_head == tail)
+    ring->cached_head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+  return ring->cached_head - tail;
+}
+
+int crystalhd_ring_pop(frame_ring_t *ring, image_buffer_t *img) {
+  uint32_t tail = ring->tail;
+
+  if(!crystalhd_ring_available(ring)) {
+    ring->consumer.empty++;
+    return 0;
+  }
+
+  *img = ring->slots[tail & ring->mask];
+  __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+
+  ring->consumer.popped++;
+
+  return 1;
+}
+
+image_buffer_t *crystalhd_ring_peek(frame_ring_t *ring, uint32_t i) {
+  ring->cached_head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+  if(i >= ring->cached_head - ring->tail)
+    return NULL;
+
+  return &ring->slots[(ring->tail + i) & ring->mask];
+}
+
+uint32_t crystalhd_ring_count(frame_ring_t *ring) {
+  return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) -
+    __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+}
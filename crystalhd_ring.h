@@ -0,0 +1,88 @@
+/*
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * crystalhd_ring.h: single producer, single consumer ring of decoded
+ * pictures between the receive thread and the renderer
+ */
+
+#ifndef CRYSTALHD_RING_H
+#define CRYSTALHD_RING_H
+
+#include <stdint.h>
+
+#define RING_CACHE_LINE 64
+
+struct image_buffer_s;
+
+struct frame_ring_producer_stats {
+  uint64_t  pushed;
+  /* pushes refused because the ring was full */
+  uint64_t  full;
+  /* sum of the occupancy seen by each push, for the mean. the producer
+   * sees the tail of its last check, so this is an upper bound */
+  uint64_t  depth_sum;
+  uint32_t  max_depth;
+};
+
+struct frame_ring_consumer_stats {
+  uint64_t  popped;
+  /* pops which found the ring empty */
+  uint64_t  empty;
+};
+
+/* head and the producer statistics are only written by the producer, tail
+ * and the consumer statistics only by the consumer. each side keeps its own
+ * cache line and a copy of the other index, so it reads the shared line
+ * only when its copy says the ring is full or empty. */
+typedef struct frame_ring_s {
+  struct image_buffer_s *slots;
+  uint32_t  capacity;
+  uint32_t  mask;
+
+  uint8_t   pad0[RING_CACHE_LINE];
+
+  uint32_t  head;
+  uint32_t  cached_tail;
+  struct frame_ring_producer_stats producer;
+
+  uint8_t   pad1[RING_CACHE_LINE];
+
+  uint32_t  tail;
+  uint32_t  cached_head;
+  struct frame_ring_consumer_stats consumer;
+
+  uint8_t   pad2[RING_CACHE_LINE];
+} frame_ring_t;
+
+/* capacity is rounded up to a power of two */
+frame_ring_t *crystalhd_ring_create(uint32_t capacity);
+void crystalhd_ring_free(frame_ring_t *ring);
+
+/* producer side. push copies img into the ring and returns 0 if it is full */
+int crystalhd_ring_full(frame_ring_t *ring);
+int crystalhd_ring_push(frame_ring_t *ring, const struct image_buffer_s *img);
+
+/* consumer side. pop copies the oldest picture to img and returns 0 if the
+ * ring is empty. peek returns the i-th queued picture, which the consumer
+ * may modify in place, or NULL. */
+int crystalhd_ring_pop(frame_ring_t *ring, struct image_buffer_s *img);
+struct image_buffer_s *crystalhd_ring_peek(frame_ring_t *ring, uint32_t i);
+
+/* number of queued pictures, exact only on the consumer side */
+uint32_t crystalhd_ring_count(frame_ring_t *ring);
+
+#endif
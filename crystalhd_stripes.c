@@ -0,0 +1,169 @@
+/*
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * crystalhd_stripes.c: worker threads which copy or convert a picture in
+ * horizontal stripes
+ *
+ * A picture is cut into one stripe per thread. The renderer posts the job,
+ * takes stripes itself like the workers do and waits for the last one, so
+ * the picture is complete when crystalhd_stripes_run returns. Between
+ * pictures the workers sleep on the start condition.
+ */
+
+#include <stdlib.h>
+
+#include "crystalhd_stripes.h"
+
+/* the next stripe of the current job, called with the mutex held */
+static int stripe_take(stripe_pool_t *pool, int *first_row, int *rows) {
+  if(pool->next_row >= pool->rows)
+    return 0;
+
+  *first_row = pool->next_row;
+  *rows = pool->rows - pool->next_row;
+  if(*rows > pool->stripe_rows)
+    *rows = pool->stripe_rows;
+  pool->next_row += *rows;
+  pool->stats.stripes++;
+
+  return 1;
+}
+
+/* runs stripes until none is left, called with the mutex held */
+static int stripe_work(stripe_pool_t *pool) {
+  int first_row, rows, taken = 0;
+
+  while(stripe_take(pool, &first_row, &rows)) {
+    stripe_func_t func = pool->func;
+    void *arg = pool->arg;
+
+    pthread_mutex_unlock(&pool->mutex);
+    func(arg, first_row, rows);
+    pthread_mutex_lock(&pool->mutex);
+
+    taken++;
+    if(--pool->pending == 0)
+      pthread_cond_signal(&pool->done);
+  }
+
+  return taken;
+}
+
+static void *crystalhd_stripes_thread(void *this_gen) {
+  stripe_pool_t *pool = (stripe_pool_t *) this_gen;
+  uint32_t generation = 0;
+
+  pthread_mutex_lock(&pool->mutex);
+
+  while(1) {
+    while(!pool->stop && pool->generation == generation)
+      pthread_cond_wait(&pool->start, &pool->mutex);
+
+    if(pool->stop)
+      break;
+
+    generation = pool->generation;
+    pool->stats.worker_stripes += stripe_work(pool);
+  }
+
+  pthread_mutex_unlock(&pool->mutex);
+
+  return NULL;
+}
+
+stripe_pool_t *crystalhd_stripes_create(int workers) {
+  stripe_pool_t *pool;
+  int i;
+
+  if(workers <= 0)
+    return NULL;
+  if(workers > STRIPES_MAX_WORKERS)
+    workers = STRIPES_MAX_WORKERS;
+
+  pool = calloc(1, sizeof(stripe_pool_t));
+  pool->threads = calloc(workers, sizeof(pthread_t));
+
+  pthread_mutex_init(&pool->mutex, NULL);
+  pthread_cond_init(&pool->start, NULL);
+  pthread_cond_init(&pool->done, NULL);
+
+  for(i = 0; i < workers; i++) {
+    if(pthread_create(&pool->threads[i], NULL, crystalhd_stripes_thread, pool))
+      break;
+  }
+  pool->workers = i;
+
+  return pool;
+}
+
+void crystalhd_stripes_free(stripe_pool_t *pool) {
+  int i;
+
+  if(!pool)
+    return;
+
+  pthread_mutex_lock(&pool->mutex);
+  pool->stop = 1;
+  pthread_cond_broadcast(&pool->start);
+  pthread_mutex_unlock(&pool->mutex);
+
+  for(i = 0; i < pool->workers; i++)
+    pthread_join(pool->threads[i], NULL);
+
+  pthread_cond_destroy(&pool->done);
+  pthread_cond_destroy(&pool->start);
+  pthread_mutex_destroy(&pool->mutex);
+
+  free(pool->threads);
+  free(pool);
+}
+
+void crystalhd_stripes_run(stripe_pool_t *pool, stripe_func_t func, void *arg,
+    int rows, int align) {
+
+  int stripes, stripe_rows;
+
+  if(!pool || pool->workers == 0) {
+    func(arg, 0, rows);
+    return;
+  }
+
+  stripes = pool->workers + 1;
+  stripe_rows = (rows + stripes - 1) / stripes;
+  stripe_rows = (stripe_rows + align - 1) / align * align;
+
+  pthread_mutex_lock(&pool->mutex);
+
+  pool->func = func;
+  pool->arg = arg;
+  pool->rows = rows;
+  pool->stripe_rows = stripe_rows ? stripe_rows : align;
+  pool->next_row = 0;
+  pool->pending = (rows + pool->stripe_rows - 1) / pool->stripe_rows;
+  pool->generation++;
+  pool->stats.jobs++;
+
+  if(pool->pending > 1)
+    pthread_cond_broadcast(&pool->start);
+
+  stripe_work(pool);
+
+  while(pool->pending > 0)
+    pthread_cond_wait(&pool->done, &pool->mutex);
+
+  pthread_mutex_unlock(&pool->mutex);
+}
@@ -0,0 +1,75 @@
+/*
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * crystalhd_stripes.h: worker threads which copy or convert a picture in
+ * horizontal stripes
+ */
+
+#ifndef CRYSTALHD_STRIPES_H
+#define CRYSTALHD_STRIPES_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+/* most worker threads of a pool */
+#define STRIPES_MAX_WORKERS   16
+
+/* processes rows rows starting at first_row of the picture arg */
+typedef void (*stripe_func_t)(void *arg, int first_row, int rows);
+
+struct stripe_stats {
+  uint64_t  jobs;
+  uint64_t  stripes;
+  /* stripes which a worker took, the rest ran on the calling thread */
+  uint64_t  worker_stripes;
+};
+
+typedef struct stripe_pool_s {
+  pthread_t         *threads;
+  int               workers;
+
+  pthread_mutex_t   mutex;
+  /* signalled when a job was posted or the workers have to stop */
+  pthread_cond_t    start;
+  /* signalled when the last stripe of a job is done */
+  pthread_cond_t    done;
+
+  /* the current job, its stripes are handed out in order */
+  stripe_func_t     func;
+  void              *arg;
+  int               rows;
+  int               stripe_rows;
+  int               next_row;
+  int               pending;
+  /* counts the jobs, so a worker sees a new one */
+  uint32_t          generation;
+  int               stop;
+
+  struct stripe_stats stats;
+} stripe_pool_t;
+
+/* worker threads besides the calling one, NULL if workers is 0 */
+stripe_pool_t *crystalhd_stripes_create(int workers);
+void crystalhd_stripes_free(stripe_pool_t *pool);
+
+/* runs func over rows rows, split in stripes of a multiple of align rows
+ * for the workers and the calling thread, and returns when all are done.
+ * without a pool func runs over all rows on the calling thread. */
+void crystalhd_stripes_run(stripe_pool_t *pool, stripe_func_t func, void *arg,
+    int rows, int align);
+
+#endif
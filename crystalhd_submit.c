@@ -0,0 +1,166 @@
+/*
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * crystalhd_submit.c: bounded queue and thread which feed access units
+ * to the hardware, so a busy DtsProcInput does not block the parser
+ */
+
+#include "crystalhd_decoder.h"
+#include "crystalhd_hw.h"
+#include "crystalhd_submit.h"
+
+static void *crystalhd_submit_thread (void *this_gen) {
+  crystalhd_submit_t *submit = (crystalhd_submit_t *) this_gen;
+
+  pthread_mutex_lock(&submit->mutex);
+
+  while(1) {
+    while(!submit->stop && submit->count == 0)
+      pthread_cond_wait(&submit->queued, &submit->mutex);
+
+    if(submit->stop)
+      break;
+
+    /* the unit stays in its slot while it is sent, the producer
+     * can't reuse the slot as count still includes it */
+    struct submit_unit *unit = &submit->units[submit->head];
+    submit->sending = 1;
+    pthread_mutex_unlock(&submit->mutex);
+
+    crystalhd_send_data(submit->decoder, hDevice, unit->buf, unit->len, unit->pts);
+
+    pthread_mutex_lock(&submit->mutex);
+    submit->sending = 0;
+    submit->head = (submit->head + 1) % submit->capacity;
+    submit->count--;
+    submit->stats.submitted++;
+    pthread_cond_broadcast(&submit->done);
+  }
+
+  pthread_mutex_unlock(&submit->mutex);
+
+  return NULL;
+}
+
+static void crystalhd_submit_release(crystalhd_submit_t *submit) {
+  uint32_t i;
+
+  pthread_cond_destroy(&submit->done);
+  pthread_cond_destroy(&submit->queued);
+  pthread_mutex_destroy(&submit->mutex);
+
+  for(i = 0; i < submit->capacity; i++)
+    free(submit->units[i].buf);
+  free(submit->units);
+  free(submit);
+}
+
+crystalhd_submit_t *crystalhd_submit_create(struct crystalhd_video_decoder_s *decoder,
+    uint32_t capacity) {
+
+  crystalhd_submit_t *submit = calloc(1, sizeof(crystalhd_submit_t));
+  pthread_attr_t thread_attr;
+
+  submit->decoder = decoder;
+  submit->capacity = capacity;
+  submit->units = calloc(capacity, sizeof(struct submit_unit));
+
+  pthread_mutex_init(&submit->mutex, NULL);
+  pthread_cond_init(&submit->queued, NULL);
+  pthread_cond_init(&submit->done, NULL);
+
+  pthread_attr_init(&thread_attr);
+  pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_JOINABLE);
+  if(pthread_create(&submit->thread, &thread_attr, crystalhd_submit_thread, submit)) {
+    xprintf(decoder->xine, XINE_VERBOSITY_LOG,
+        "crystalhd_submit: can't create the submit thread\n");
+    pthread_attr_destroy(&thread_attr);
+    crystalhd_submit_release(submit);
+    return NULL;
+  }
+  pthread_attr_destroy(&thread_attr);
+
+  return submit;
+}
+
+void crystalhd_submit_free(crystalhd_submit_t *submit) {
+  pthread_mutex_lock(&submit->mutex);
+  submit->stop = 1;
+  pthread_cond_broadcast(&submit->queued);
+  pthread_mutex_unlock(&submit->mutex);
+  pthread_join(submit->thread, NULL);
+
+  crystalhd_submit_release(submit);
+}
+
+void crystalhd_submit_push(crystalhd_submit_t *submit, uint8_t **buf,
+    uint32_t *size, uint32_t len, int64_t pts) {
+
+  pthread_mutex_lock(&submit->mutex);
+
+  if(submit->count == submit->capacity) {
+    submit->stats.full_waits++;
+    while(submit->count == submit->capacity)
+      pthread_cond_wait(&submit->done, &submit->mutex);
+  }
+
+  struct submit_unit *unit =
+    &submit->units[(submit->head + submit->count) % submit->capacity];
+
+  uint8_t *tmp_buf = unit->buf;
+  uint32_t tmp_size = unit->size;
+  unit->buf = *buf;
+  unit->size = *size;
+  unit->len = len;
+  unit->pts = pts;
+  *buf = tmp_buf;
+  *size = tmp_size;
+
+  submit->stats.pushed++;
+  submit->stats.depth_sum += submit->count;
+  submit->count++;
+  if(submit->count > submit->stats.max_depth)
+    submit->stats.max_depth = submit->count;
+
+  pthread_cond_signal(&submit->queued);
+  pthread_mutex_unlock(&submit->mutex);
+}
+
+void crystalhd_submit_flush(crystalhd_submit_t *submit) {
+  uint32_t keep;
+
+  pthread_mutex_lock(&submit->mutex);
+
+  /* the unit which is being sent can't be taken back */
+  keep = submit->sending ? 1 : 0;
+  submit->stats.flushed += submit->count - keep;
+  submit->count = keep;
+
+  while(submit->sending)
+    pthread_cond_wait(&submit->done, &submit->mutex);
+
+  pthread_mutex_unlock(&submit->mutex);
+}
+
+void crystalhd_submit_drain(crystalhd_submit_t *submit) {
+  pthread_mutex_lock(&submit->mutex);
+
+  while(submit->count > 0)
+    pthread_cond_wait(&submit->done, &submit->mutex);
+
+  pthread_mutex_unlock(&submit->mutex);
+}
@@ -0,0 +1,85 @@
+/*
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * crystalhd_submit.h: bounded queue and thread which feed access units
+ * to the hardware, so a busy DtsProcInput does not block the parser
+ */
+
+#ifndef CRYSTALHD_SUBMIT_H
+#define CRYSTALHD_SUBMIT_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+struct crystalhd_video_decoder_s;
+
+/* an access unit waiting to be sent, the buffer belongs to the queue */
+struct submit_unit {
+  uint8_t   *buf;
+  uint32_t  size;
+  uint32_t  len;
+  int64_t   pts;
+};
+
+struct submit_stats {
+  uint64_t  pushed;
+  uint64_t  submitted;
+  /* dropped by a flush before they were sent */
+  uint64_t  flushed;
+  /* pushes which had to wait for a free slot */
+  uint64_t  full_waits;
+  /* sum of the queue depth seen by each push, for the mean occupancy */
+  uint64_t  depth_sum;
+  uint32_t  max_depth;
+};
+
+typedef struct crystalhd_submit_s {
+  struct crystalhd_video_decoder_s *decoder;
+
+  pthread_t         thread;
+  pthread_mutex_t   mutex;
+  /* signalled when a unit was queued or the thread has to stop */
+  pthread_cond_t    queued;
+  /* signalled when a unit was sent or dropped */
+  pthread_cond_t    done;
+
+  struct submit_unit *units;
+  uint32_t  capacity;
+  /* units[head] is sent next, count includes the one being sent */
+  uint32_t  head;
+  uint32_t  count;
+  /* the thread is inside DtsProcInput with units[head] */
+  int       sending;
+  int       stop;
+
+  struct submit_stats stats;
+} crystalhd_submit_t;
+
+crystalhd_submit_t *crystalhd_submit_create(struct crystalhd_video_decoder_s *decoder,
+    uint32_t capacity);
+void crystalhd_submit_free(crystalhd_submit_t *submit);
+
+/* queues len bytes of *buf, blocks while the queue is full. the queue
+ * keeps *buf and returns a free buffer (or NULL) in exchange. */
+void crystalhd_submit_push(crystalhd_submit_t *submit, uint8_t **buf,
+    uint32_t *size, uint32_t len, int64_t pts);
+/* drops all queued units and waits for the one being sent */
+void crystalhd_submit_flush(crystalhd_submit_t *submit);
+/* waits until all queued units were sent */
+void crystalhd_submit_drain(crystalhd_submit_t *submit);
+
+#endif
@@ -23,6 +23,7 @@
 //#define LOG
 
 #include "crystalhd_vc1.h"
+#include "startcode.h"
 
 #define sequence_header_code    0x0f
 #define sequence_end_code       0x0a
@@ -441,19 +442,20 @@ void parse_header( crystalhd_video_decoder_t *this, uint8_t *buf, int len )
   lprintf("parse_header\n");
 
   while ( off < (len-4) ) {
-    uint8_t *buffer = buf+off;
-    if ( buffer[0]==0 && buffer[1]==0 && buffer[2]==1 ) {
-      switch ( buffer[3] ) {
-        case sequence_header_code: 
-          sequence_header( this, buf+off+4, len-off-4 ); 
-
-          free(sequence->bytestream);
-          sequence->bytestream_bytes = len-off;
-          sequence->bytestream = realloc( sequence->bytestream, sequence->bytestream_bytes );
-          xine_fast_memcpy(sequence->bytestream, buf+off, sequence->bytestream_bytes);
+    int next = find_start_code( buf+off, len-off-2 );
+    if ( next<0 )
+      break;
+    off += next;
+    switch ( buf[off+3] ) {
+      case sequence_header_code: 
+        sequence_header( this, buf+off+4, len-off-4 ); 
+
+        free(sequence->bytestream);
+        sequence->bytestream_bytes = len-off;
+        sequence->bytestream = realloc( sequence->bytestream, sequence->bytestream_bytes );
+        xine_fast_memcpy(sequence->bytestream, buf+off, sequence->bytestream_bytes);
           
-          break;
-      }
+        break;
     }
     ++off;
   }
@@ -674,35 +676,39 @@ void crystalhd_vc1_decode_data (video_decoder_t *this_gen,
   }
 
   int res, startcode=0;
-  while ( seq->bufseek <= seq->bufpos-4 ) {
+  while ( seq->bufseek+4 <= (int)seq->bufpos ) {
+    int next = find_start_code( seq->buf+seq->bufseek, seq->bufpos-seq->bufseek-1 );
+    if ( next<0 ) {
+      seq->bufseek = seq->bufpos-3;
+      break;
+    }
+    seq->bufseek += next;
     uint8_t *buffer = seq->buf+seq->bufseek;
-    if ( buffer[0]==0 && buffer[1]==0 && buffer[2]==1 ) {
-      startcode = 1;
-      seq->current_code = buffer[3];
-      //lprintf("current_code = %d\n", seq->current_code);
-      if ( seq->start<0 ) {
-        seq->start = seq->bufseek;
-        seq->code_start = buffer[3];
-        //lprintf("code_start = %d\n", seq->code_start);
-        if ( seq->cur_pts ) {
-          seq->seq_pts = seq->cur_pts;
-        }
-      } else {
-        res = parse_code( this, seq->buf+seq->start, seq->bufseek-seq->start );
-        if ( res==1 ) {
-          seq->mode = MODE_STARTCODE;
-          decode_picture(this);
-          parse_code( this, seq->buf+seq->start, seq->bufseek-seq->start );
-        }
-        if ( res!=-1 ) {
-          uint8_t *tmp = (uint8_t*)malloc(seq->bufsize);
-          xine_fast_memcpy( tmp, seq->buf+seq->bufseek, seq->bufpos-seq->bufseek );
-          seq->bufpos -= seq->bufseek;
-          seq->start = -1;
-          seq->bufseek = -1;
-          free( seq->buf );
-          seq->buf = tmp;
-        }
+    startcode = 1;
+    seq->current_code = buffer[3];
+    //lprintf("current_code = %d\n", seq->current_code);
+    if ( seq->start<0 ) {
+      seq->start = seq->bufseek;
+      seq->code_start = buffer[3];
+      //lprintf("code_start = %d\n", seq->code_start);
+      if ( seq->cur_pts ) {
+        seq->seq_pts = seq->cur_pts;
+      }
+    } else {
+      res = parse_code( this, seq->buf+seq->start, seq->bufseek-seq->start );
+      if ( res==1 ) {
+        seq->mode = MODE_STARTCODE;
+        decode_picture(this);
+        parse_code( this, seq->buf+seq->start, seq->bufseek-seq->start );
+      }
+      if ( res!=-1 ) {
+        uint8_t *tmp = (uint8_t*)malloc(seq->bufsize);
+        xine_fast_memcpy( tmp, seq->buf+seq->bufseek, seq->bufpos-seq->bufseek );
+        seq->bufpos -= seq->bufseek;
+        seq->start = -1;
+        seq->bufseek = -1;
+        free( seq->buf );
+        seq->buf = tmp;
       }
     }
     ++seq->bufseek;
@@ -0,0 +1,160 @@
+/*
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * crystalhd_yuv.c: moves the pictures of the card into vo frames
+ *
+ * In 4:2:0 mode the card delivers NV12, a Y plane and a plane of
+ * interleaved U/V pairs. xine wants YV12 with separate U and V planes, so
+ * the UV plane is split on the way into the vo frame, 16 pairs at a time
+ * with SSE2 or 32 with AVX2 if the cpu has it.
+ *
+ * crystalhd_yuv_picture_rows moves a part of a picture, so the renderer can
+ * hand the stripes of a big one to several threads.
+ */
+
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define YUV_HAVE_AVX2
+#endif
+
+#include "crystalhd_copy.h"
+#include "crystalhd_yuv.h"
+
+static void split_uv_row_tail(uint8_t *u, uint8_t *v, const uint8_t *uv, int x, int width) {
+  for(; x < width; x++) {
+    u[x] = uv[2 * x];
+    v[x] = uv[2 * x + 1];
+  }
+}
+
+static void split_uv_row(uint8_t *u, uint8_t *v, const uint8_t *uv, int width) {
+  int x = 0;
+
+#ifdef __SSE2__
+  const __m128i mask = _mm_set1_epi16(0x00ff);
+
+  for(; x + 16 <= width; x += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(uv + 2 * x));
+    __m128i b = _mm_loadu_si128((const __m128i *)(uv + 2 * x + 16));
+
+    _mm_storeu_si128((__m128i *)(u + x),
+        _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask)));
+    _mm_storeu_si128((__m128i *)(v + x),
+        _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+  }
+#endif
+
+  split_uv_row_tail(u, v, uv, x, width);
+}
+
+#ifdef YUV_HAVE_AVX2
+__attribute__((target("avx2")))
+static void split_uv_row_avx2(uint8_t *u, uint8_t *v, const uint8_t *uv, int width) {
+  const __m256i mask = _mm256_set1_epi16(0x00ff);
+  int x = 0;
+
+  for(; x + 32 <= width; x += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(uv + 2 * x));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(uv + 2 * x + 32));
+
+    /* packus works per 128 bit lane, the permute puts the quarters in order */
+    _mm256_storeu_si256((__m256i *)(u + x), _mm256_permute4x64_epi64(
+        _mm256_packus_epi16(_mm256_and_si256(a, mask), _mm256_and_si256(b, mask)), 0xd8));
+    _mm256_storeu_si256((__m256i *)(v + x), _mm256_permute4x64_epi64(
+        _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8)), 0xd8));
+  }
+
+  split_uv_row(u + x, v + x, uv + 2 * x, width - x);
+}
+#endif
+
+typedef void (*split_uv_row_t)(uint8_t *u, uint8_t *v, const uint8_t *uv, int width);
+
+static split_uv_row_t split_uv_row_best(void) {
+  static split_uv_row_t best;
+
+  /* a race only picks the same function twice */
+  if(!best) {
+    best = split_uv_row;
+#ifdef YUV_HAVE_AVX2
+    if(__builtin_cpu_supports("avx2"))
+      best = split_uv_row_avx2;
+#endif
+  }
+
+  return best;
+}
+
+void crystalhd_yuv_split_uv(uint8_t *u, int u_pitch, uint8_t *v, int v_pitch,
+    const uint8_t *uv, int uv_pitch, int width, int height) {
+  split_uv_row_t split = split_uv_row_best();
+  int i;
+
+  for(i = 0; i < height; i++)
+    split(u + (size_t)i * u_pitch, v + (size_t)i * v_pitch,
+        uv + (size_t)i * uv_pitch, width);
+}
+
+void crystalhd_yuv_picture_stream(struct yuv_picture *pic) {
+  size_t bytes = (size_t)pic->width * pic->height;
+
+  /* the luma plane and the chroma split for yv12 */
+  pic->stream = crystalhd_copy_stream(pic->yv12 ? bytes * 3 / 2 : bytes * 2);
+}
+
+void crystalhd_yuv_picture_rows(void *picture, int first_row, int rows) {
+  struct yuv_picture *pic = (struct yuv_picture *) picture;
+  int chroma_width, chroma_row;
+
+  if(!pic->yv12) {
+    crystalhd_copy_plane(pic->dst[0] + (size_t)first_row * pic->pitches[0], pic->pitches[0],
+        pic->y + (size_t)first_row * pic->width * 2, pic->width * 2, pic->width * 2, rows, pic->stream);
+    return;
+  }
+
+  chroma_width = (pic->width + 1) / 2;
+  chroma_row = first_row / 2;
+
+  crystalhd_copy_plane(pic->dst[0] + (size_t)first_row * pic->pitches[0], pic->pitches[0],
+      pic->y + (size_t)first_row * pic->width, pic->width, pic->width, rows, pic->stream);
+  crystalhd_yuv_split_uv(pic->dst[1] + (size_t)chroma_row * pic->pitches[1], pic->pitches[1],
+      pic->dst[2] + (size_t)chroma_row * pic->pitches[2], pic->pitches[2],
+      pic->uv + (size_t)chroma_row * chroma_width * 2, chroma_width * 2,
+      chroma_width, (first_row + rows + 1) / 2 - chroma_row);
+}
+
+void crystalhd_yuv_nv12_to_yv12(const uint8_t *y, const uint8_t *uv, int width, int height,
+    uint8_t *dst[3], const int pitches[3]) {
+  struct yuv_picture pic;
+
+  pic.yv12 = 1;
+  pic.y = y;
+  pic.uv = uv;
+  pic.width = width;
+  pic.height = height;
+  memcpy(pic.dst, dst, sizeof(pic.dst));
+  memcpy(pic.pitches, pitches, sizeof(pic.pitches));
+  crystalhd_yuv_picture_stream(&pic);
+
+  crystalhd_yuv_picture_rows(&pic, 0, height);
+}
@@ -0,0 +1,57 @@
+/*
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * crystalhd_yuv.h: moves the pictures of the card into vo frames
+ */
+
+#ifndef CRYSTALHD_YUV_H
+#define CRYSTALHD_YUV_H
+
+#include <stdint.h>
+
+/* splits height rows of width interleaved U/V pairs into a U and a V plane */
+void crystalhd_yuv_split_uv(uint8_t *u, int u_pitch, uint8_t *v, int v_pitch,
+    const uint8_t *uv, int uv_pitch, int width, int height);
+
+/* a picture of the card and the vo frame it goes to */
+struct yuv_picture {
+  /* NV12 to YV12, else packed YUY2 to YUY2 */
+  int           yv12;
+  const uint8_t *y;
+  const uint8_t *uv;
+  int           width;
+  int           height;
+  uint8_t       *dst[3];
+  int           pitches[3];
+  /* the stripes bypass the cache, see crystalhd_yuv_picture_stream */
+  int           stream;
+};
+
+/* sets stream of pic from the bytes of the whole picture, before it is
+ * split in stripes */
+void crystalhd_yuv_picture_stream(struct yuv_picture *pic);
+
+/* moves rows rows of picture, a struct yuv_picture, starting at first_row.
+ * for yv12 first_row has to be even. fits crystalhd_stripes_run. */
+void crystalhd_yuv_picture_rows(void *picture, int first_row, int rows);
+
+/* a NV12 picture of the card, with packed lines, to the planes of a YV12
+ * vo frame */
+void crystalhd_yuv_nv12_to_yv12(const uint8_t *y, const uint8_t *uv, int width, int height,
+    uint8_t *dst[3], const int pitches[3]);
+
+#endif
@@ -42,13 +42,13 @@ int dp_top_field_first(struct decoded_picture *decoded_pic)
 
 
   if (decoded_pic->coded_pic[1] != NULL) {
-    if (!decoded_pic->coded_pic[0]->slc_nal->slc.bottom_field_flag &&
-        decoded_pic->coded_pic[1]->slc_nal->slc.bottom_field_flag &&
+    if (!decoded_pic->coded_pic[0]->slc_nal->slc->bottom_field_flag &&
+        decoded_pic->coded_pic[1]->slc_nal->slc->bottom_field_flag &&
         decoded_pic->coded_pic[0]->top_field_order_cnt !=
             decoded_pic->coded_pic[1]->bottom_field_order_cnt) {
       top_field_first = decoded_pic->coded_pic[0]->top_field_order_cnt < decoded_pic->coded_pic[1]->bottom_field_order_cnt;
-    } else if (decoded_pic->coded_pic[0]->slc_nal->slc.bottom_field_flag &&
-        !decoded_pic->coded_pic[1]->slc_nal->slc.bottom_field_flag &&
+    } else if (decoded_pic->coded_pic[0]->slc_nal->slc->bottom_field_flag &&
+        !decoded_pic->coded_pic[1]->slc_nal->slc->bottom_field_flag &&
         decoded_pic->coded_pic[0]->bottom_field_order_cnt !=
             decoded_pic->coded_pic[1]->top_field_order_cnt) {
       top_field_first = decoded_pic->coded_pic[0]->bottom_field_order_cnt > decoded_pic->coded_pic[1]->top_field_order_cnt;
@@ -56,7 +56,7 @@ int dp_top_field_first(struct decoded_picture *decoded_pic)
   }
 
   if (decoded_pic->coded_pic[0]->flag_mask & PIC_STRUCT_PRESENT && decoded_pic->coded_pic[0]->sei_nal != NULL) {
-    uint8_t pic_struct = decoded_pic->coded_pic[0]->sei_nal->sei.pic_timing.pic_struct;
+    uint8_t pic_struct = decoded_pic->coded_pic[0]->sei_nal->sei->pic_timing.pic_struct;
     if(pic_struct == DISP_TOP_BOTTOM ||
         pic_struct == DISP_TOP_BOTTOM_TOP) {
       top_field_first = 1;
@@ -100,12 +100,12 @@ void decoded_pic_check_reference(struct decoded_picture *pic)
     if(cpic && (cpic->flag_mask & REFERENCE)) {
       // FIXME: this assumes Top Field First!
       if(i == 0) {
-        pic->top_is_reference = cpic->slc_nal->slc.field_pic_flag
-                    ? (cpic->slc_nal->slc.bottom_field_flag ? 0 : 1) : 1;
+        pic->top_is_reference = cpic->slc_nal->slc->field_pic_flag
+                    ? (cpic->slc_nal->slc->bottom_field_flag ? 0 : 1) : 1;
       }
 
-      pic->bottom_is_reference = cpic->slc_nal->slc.field_pic_flag
-                    ? (cpic->slc_nal->slc.bottom_field_flag ? 1 : 0) : 1;
+      pic->bottom_is_reference = cpic->slc_nal->slc->field_pic_flag
+                    ? (cpic->slc_nal->slc->bottom_field_flag ? 1 : 0) : 1;
     }
   }
 }
@@ -589,7 +589,7 @@ int fill_vdpau_reference_list(struct dpb *dpb, VdpReferenceFrameH264 *reflist)
 
     reflist[i].frame_idx = pic->coded_pic[0]->used_for_long_term_ref ?
         pic->coded_pic[0]->long_term_pic_num :
-        pic->coded_pic[0]->slc_nal->slc.frame_num;
+        pic->coded_pic[0]->slc_nal->slc->frame_num;
     reflist[i].top_is_reference = pic->top_is_reference;
     reflist[i].bottom_is_reference = pic->bottom_is_reference;
     reflist[i].field_order_cnt[0] = pic->coded_pic[0]->top_field_order_cnt;
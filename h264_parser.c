@@ -27,6 +27,7 @@
 #include "h264_parser.h"
 #include "nal.h"
 #include "cpb.h"
+#include "startcode.h"
 
 /* default scaling_lists according to Table 7-2 */
 uint8_t default_4x4_intra[16] = { 6, 13, 13, 20, 20, 20, 28, 28, 28, 28, 32,
@@ -45,19 +46,15 @@ uint8_t default_8x8_inter[64] = { 9, 13, 13, 15, 13, 15, 17, 17, 17, 17, 19,
     24, 24, 24, 24, 24, 24, 25, 25, 25, 25, 25, 25, 25, 27, 27, 27, 27, 27, 27,
     28, 28, 28, 28, 28, 30, 30, 30, 30, 32, 32, 32, 33, 33, 35 };
 
-struct buf_reader
-{
-  uint8_t *buf;
-  uint8_t *cur_pos;
-  int len;
-  int cur_offset;
-};
-
 struct h264_parser* init_parser();
+static int parse_frame_prebuf(struct h264_parser *parser, uint8_t *inbuf,
+    int inbuf_len, int64_t pts,
+    uint8_t **ret_buf, uint32_t *ret_len, struct coded_picture **ret_pic);
+static int parse_frame_avcc(struct h264_parser *parser, uint8_t *inbuf,
+    int inbuf_len, int64_t pts,
+    uint8_t **ret_buf, uint32_t *ret_len, struct coded_picture **ret_pic);
 
 static inline uint32_t read_bits(struct buf_reader *buf, int len);
-uint32_t read_exp_golomb(struct buf_reader *buf);
-int32_t read_exp_golomb_s(struct buf_reader *buf);
 
 void calculate_pic_order(struct h264_parser *parser, struct coded_picture *pic,
     struct slice_header *slc);
@@ -207,6 +204,62 @@ static inline uint32_t read_bits(struct buf_reader *buf, int len)
   return bits;
 }
 
+/*
+ * skip len bits, emulation prevention bytes are not counted
+ */
+static inline void skip_bits(struct buf_reader *buf, int len)
+{
+  while (len > 0 && (buf->cur_pos - buf->buf) < buf->len) {
+    if (len < buf->cur_offset) {
+      buf->cur_offset -= len;
+      return;
+    }
+    len -= buf->cur_offset;
+    buf->cur_pos++;
+    buf->cur_offset = 8;
+
+    skip_emulation_prevention_three_byte(buf);
+  }
+}
+
+/*
+ * returns the next 32 bits left aligned without consuming them.
+ * emulation prevention bytes are skipped, *avail is set to the
+ * number of valid bits in the window
+ */
+static inline uint32_t peek_bits32(struct buf_reader *buf, int *avail)
+{
+  uint8_t *p = buf->cur_pos;
+  uint8_t *end = buf->buf + buf->len;
+  uint64_t window;
+  int bits;
+
+  if (p >= end) {
+    *avail = 0;
+    return 0;
+  }
+
+  window = *p++ & ((1 << buf->cur_offset) - 1);
+  bits = buf->cur_offset;
+
+  while (bits < 32 && p < end) {
+    if (p - buf->buf > 2 && p[-2] == 0x00 && p[-1] == 0x00 && p[0] == 0x03) {
+      p++;
+      continue;
+    }
+    window = (window << 8) | *p++;
+    bits += 8;
+  }
+
+  if (bits >= 32) {
+    *avail = 32;
+    return (uint32_t)(window >> (bits - 32));
+  }
+
+  *avail = bits;
+  return (uint32_t)(window << (32 - bits));
+}
+
 /* determines if following bits are rtsb_trailing_bits */
 static inline int rbsp_trailing_bits(uint8_t *buf, int buf_len)
 {
@@ -230,7 +283,7 @@ static inline int rbsp_trailing_bits(uint8_t *buf, int buf_len)
   return 0;
 }
 
-uint32_t read_exp_golomb(struct buf_reader *buf)
+static uint32_t read_exp_golomb_slow(struct buf_reader *buf)
 {
   int leading_zero_bits = 0;
 
@@ -242,6 +295,27 @@ uint32_t read_exp_golomb(struct buf_reader *buf)
   return code;
 }
 
+/*
+ * codes with up to 15 leading zeros fit into a 32 bit window, so
+ * prefix and suffix can be consumed at once:
+ * codeNum = (1 << lz | suffix) - 1 = window[0..2*lz] - 1
+ */
+uint32_t read_exp_golomb(struct buf_reader *buf)
+{
+  int avail;
+  uint32_t window = peek_bits32(buf, &avail);
+
+  if (window) {
+    int len = 2 * __builtin_clz(window) + 1;
+    if (len <= avail) {
+      skip_bits(buf, len);
+      return (window >> (32 - len)) - 1;
+    }
+  }
+
+  return read_exp_golomb_slow(buf);
+}
+
 int32_t read_exp_golomb_s(struct buf_reader *buf)
 {
   uint32_t ue = read_exp_golomb(buf);
@@ -254,17 +328,57 @@ int32_t read_exp_golomb_s(struct buf_reader *buf)
  * parses the NAL header data and calls the subsequent
  * parser methods that handle specific NAL units
  */
+/**
+ * looks up the sps or pps in buf by its id and returns the stored
+ * nal unit if it was parsed from the same bytes
+ */
+static struct nal_unit* get_repeated_parameter_set(struct buf_reader *buf,
+    struct h264_parser *parser)
+{
+  struct buf_reader id_buf;
+  struct nal_unit *nal;
+  uint32_t id;
+
+  id_buf.buf = buf->buf;
+  id_buf.cur_pos = buf->buf + 1;
+  id_buf.cur_offset = 8;
+  id_buf.len = buf->len;
+
+  if ((buf->buf[0] & 0x1f) == NAL_SPS) {
+    /* profile_idc, constraint flags and level_idc */
+    skip_bits(&id_buf, 24);
+    id = read_exp_golomb(&id_buf);
+    nal = nal_table_get_repeated(parser->sps_table, id, buf->buf, buf->len);
+  } else {
+    id = read_exp_golomb(&id_buf);
+    nal = nal_table_get_repeated(parser->pps_table, id, buf->buf, buf->len);
+  }
+
+  if (nal != NULL)
+    parser->stats.param_sets_repeated++;
+
+  return nal;
+}
+
 struct nal_unit* parse_nal_header(struct buf_reader *buf,
     struct coded_picture *pic, struct h264_parser *parser)
 {
   if (buf->len < 1)
     return NULL;
 
+  /* a repeated parameter set is not parsed again */
+  uint8_t nal_unit_type = buf->buf[0] & 0x1f;
+  if (nal_unit_type == NAL_SPS || nal_unit_type == NAL_PPS) {
+    struct nal_unit *repeated = get_repeated_parameter_set(buf, parser);
+    if (repeated != NULL) {
+      lock_nal_unit(repeated);
+      return repeated;
+    }
+  }
 
-  struct nal_unit *nal = create_nal_unit();
+  struct nal_unit *nal = create_nal_unit(parser->nal_pool, nal_unit_type);
 
   nal->nal_ref_idc = (buf->buf[0] >> 5) & 0x03;
-  nal->nal_unit_type = buf->buf[0] & 0x1f;
 
   buf->cur_pos = buf->buf + 1;
   //lprintf("NAL: %d\n", nal->nal_unit_type);
@@ -274,10 +388,10 @@ struct nal_unit* parse_nal_header(struct buf_reader *buf,
 
   switch (nal->nal_unit_type) {
     case NAL_SPS:
-      parse_sps(buf, &nal->sps);
+      parse_sps(buf, nal->sps);
       break;
     case NAL_PPS:
-      parse_pps(buf, &nal->pps);
+      parse_pps(buf, nal->pps);
       break;
     case NAL_SLICE:
     case NAL_PART_A:
@@ -287,8 +401,8 @@ struct nal_unit* parse_nal_header(struct buf_reader *buf,
       parse_slice_header(buf, nal, parser);
       break;
     case NAL_SEI:
-      memset(&(nal->sei), 0x00, sizeof(struct sei_message));
-      parse_sei(buf, &nal->sei, parser);
+      memset(nal->sei, 0x00, sizeof(struct sei_message));
+      parse_sei(buf, nal->sei, parser);
       break;
     default:
       break;
@@ -306,7 +420,7 @@ void calculate_pic_order(struct h264_parser *parser, struct coded_picture *pic,
 {
   /* retrieve sps and pps from the buffers */
   struct nal_unit *pps_nal =
-      nal_buffer_get_by_pps_id(parser->pps_buffer, slc->pic_parameter_set_id);
+      nal_table_get(parser->pps_table, slc->pic_parameter_set_id);
 
   if (pps_nal == NULL) {
     xprintf(parser->xine, XINE_VERBOSITY_DEBUG,
@@ -315,10 +429,10 @@ void calculate_pic_order(struct h264_parser *parser, struct coded_picture *pic,
     return;
   }
 
-  struct pic_parameter_set_rbsp *pps = &pps_nal->pps;
+  struct pic_parameter_set_rbsp *pps = pps_nal->pps;
 
   struct nal_unit *sps_nal =
-      nal_buffer_get_by_sps_id(parser->sps_buffer, pps->seq_parameter_set_id);
+      nal_table_get(parser->sps_table, pps->seq_parameter_set_id);
 
   if (sps_nal == NULL) {
     xprintf(parser->xine, XINE_VERBOSITY_DEBUG,
@@ -327,7 +441,7 @@ void calculate_pic_order(struct h264_parser *parser, struct coded_picture *pic,
     return;
   }
 
-  struct seq_parameter_set_rbsp *sps = &sps_nal->sps;
+  struct seq_parameter_set_rbsp *sps = sps_nal->sps;
 
   if (sps->pic_order_cnt_type == 0) {
 
@@ -378,7 +492,7 @@ void calculate_pic_order(struct h264_parser *parser, struct coded_picture *pic,
       pic->top_field_order_cnt = parser->prev_top_field_order_cnt;
 
   } else if (sps->pic_order_cnt_type == 2) {
-    uint32_t prev_frame_num = parser->last_vcl_nal ? parser->last_vcl_nal->slc.frame_num : 0;
+    uint32_t prev_frame_num = parser->last_vcl_nal ? parser->last_vcl_nal->slc->frame_num : 0;
     uint32_t prev_frame_num_offset = parser->frame_num_offset;
     uint32_t temp_pic_order_cnt = 0;
 
@@ -634,6 +748,52 @@ uint8_t parse_sps(struct buf_reader *buf, struct seq_parameter_set_rbsp *sps)
   return 0;
 }
 
+/* MaxCPB of ITU-T Rec. H264 table A-1, in units of 1000 bits */
+static uint32_t level_max_cpb(uint8_t level_idc)
+{
+  switch(level_idc) {
+    case 9:  return 350;
+    case 10: return 175;
+    case 11: return 500;
+    case 12: return 1000;
+    case 13:
+    case 20: return 2000;
+    case 21:
+    case 22: return 4000;
+    case 30: return 10000;
+    case 31: return 14000;
+    case 32: return 20000;
+    case 40: return 25000;
+    case 41:
+    case 42: return 62500;
+    case 50: return 135000;
+    case 51:
+    case 52:
+    default: return 240000;
+  }
+}
+
+/**
+ * an access unit never exceeds the coded picture buffer, so the
+ * size of the CPB for the level of the sps limits buffer growth.
+ * the NAL HRD factor of table A-2 is used as it is the larger one.
+ */
+static void set_level_buf_size(struct h264_parser *parser,
+    struct seq_parameter_set_rbsp *sps)
+{
+  uint32_t factor;
+
+  switch(sps->profile_idc) {
+    case 100: factor = 1500; break;
+    case 110: factor = 3600; break;
+    case 122:
+    case 244: factor = 4800; break;
+    default:  factor = 1200; break;
+  }
+
+  parser->level_buf_size = (uint64_t)level_max_cpb(sps->level_idc) * factor / 8;
+}
+
 /* evaluates values parsed by sps and modifies the current
  * picture according to them
  */
@@ -645,7 +805,7 @@ void interpret_sps(struct coded_picture *pic, struct h264_parser *parser)
     return;
   }
 
-  struct seq_parameter_set_rbsp *sps = &pic->sps_nal->sps;
+  struct seq_parameter_set_rbsp *sps = pic->sps_nal->sps;
 
   if(sps->vui_parameters_present_flag &&
         sps->vui_parameters.pic_struct_present_flag) {
@@ -663,7 +823,7 @@ void interpret_sps(struct coded_picture *pic, struct h264_parser *parser)
   }
 
   if(pic->slc_nal != NULL) {
-    struct slice_header *slc = &pic->slc_nal->slc;
+    struct slice_header *slc = pic->slc_nal->slc;
     if (slc->field_pic_flag == 0) {
       pic->max_pic_num = sps->max_frame_num;
       parser->curr_pic_num = slc->frame_num;
@@ -680,7 +840,7 @@ void parse_sei(struct buf_reader *buf, struct sei_message *sei,
   uint8_t tmp;
 
   struct nal_unit *sps_nal =
-      nal_buffer_get_last(parser->sps_buffer);
+      nal_table_get_last(parser->sps_table);
 
   if (sps_nal == NULL) {
     xprintf(parser->xine, XINE_VERBOSITY_DEBUG,
@@ -688,7 +848,7 @@ void parse_sei(struct buf_reader *buf, struct sei_message *sei,
     return;
   }
 
-  struct seq_parameter_set_rbsp *sps = &sps_nal->sps;
+  struct seq_parameter_set_rbsp *sps = sps_nal->sps;
 
   sei->payload_type = 0;
   while((tmp = read_bits(buf, 8)) == 0xff) {
@@ -781,8 +941,8 @@ void interpret_sei(struct coded_picture *pic)
   if(!pic->sps_nal || !pic->sei_nal)
     return;
 
-  struct seq_parameter_set_rbsp *sps = &pic->sps_nal->sps;
-  struct sei_message *sei = &pic->sei_nal->sei;
+  struct seq_parameter_set_rbsp *sps = pic->sps_nal->sps;
+  struct sei_message *sei = pic->sei_nal->sei;
 
   if(sps && sps->vui_parameters_present_flag &&
       sps->vui_parameters.pic_struct_present_flag) {
@@ -992,8 +1152,8 @@ void interpret_pps(struct coded_picture *pic)
     return;
   }
 
-  struct seq_parameter_set_rbsp *sps = &pic->sps_nal->sps;
-  struct pic_parameter_set_rbsp *pps = &pic->pps_nal->pps;
+  struct seq_parameter_set_rbsp *sps = pic->sps_nal->sps;
+  struct pic_parameter_set_rbsp *pps = pic->pps_nal->pps;
 
   int i;
   for (i = 0; i < 8; i++) {
@@ -1013,7 +1173,7 @@ void interpret_pps(struct coded_picture *pic)
 uint8_t parse_slice_header(struct buf_reader *buf, struct nal_unit *slc_nal,
     struct h264_parser *parser)
 {
-  struct slice_header *slc = &slc_nal->slc;
+  struct slice_header *slc = slc_nal->slc;
 
   slc->first_mb_in_slice = read_exp_golomb(buf);
   /* we do some parsing on the slice type, because the list is doubled */
@@ -1024,7 +1184,7 @@ uint8_t parse_slice_header(struct buf_reader *buf, struct nal_unit *slc_nal,
 
   /* retrieve sps and pps from the buffers */
   struct nal_unit *pps_nal =
-      nal_buffer_get_by_pps_id(parser->pps_buffer, slc->pic_parameter_set_id);
+      nal_table_get(parser->pps_table, slc->pic_parameter_set_id);
 
   if (pps_nal == NULL) {
     xprintf(parser->xine, XINE_VERBOSITY_DEBUG,
@@ -1033,10 +1193,10 @@ uint8_t parse_slice_header(struct buf_reader *buf, struct nal_unit *slc_nal,
     return -1;
   }
 
-  struct pic_parameter_set_rbsp *pps = &pps_nal->pps;
+  struct pic_parameter_set_rbsp *pps = pps_nal->pps;
 
   struct nal_unit *sps_nal =
-      nal_buffer_get_by_sps_id(parser->sps_buffer, pps->seq_parameter_set_id);
+      nal_table_get(parser->sps_table, pps->seq_parameter_set_id);
 
   if (sps_nal == NULL) {
     xprintf(parser->xine, XINE_VERBOSITY_DEBUG,
@@ -1045,11 +1205,12 @@ uint8_t parse_slice_header(struct buf_reader *buf, struct nal_unit *slc_nal,
     return -1;
   }
 
-  struct seq_parameter_set_rbsp *sps = &sps_nal->sps;
+  struct seq_parameter_set_rbsp *sps = sps_nal->sps;
 
   if(sps->separate_colour_plane_flag)
     slc->colour_plane_id = read_bits(buf, 2);
 
+  slc->pic_order_cnt_type = sps->pic_order_cnt_type;
   slc->frame_num = read_bits(buf, sps->log2_max_frame_num_minus4 + 4);
   if (!sps->frame_mbs_only_flag) {
     slc->field_pic_flag = read_bits(buf, 1);
@@ -1079,6 +1240,15 @@ uint8_t parse_slice_header(struct buf_reader *buf, struct nal_unit *slc_nal,
       slc->delta_pic_order_cnt[1] = read_exp_golomb_s(buf);
   }
 
+  parser->stats.slices_parsed++;
+
+  /* everything below is neither needed for the access unit
+   * boundary detection nor for the picture order count */
+  if (parser->slice_parse_mode == SLICE_PARSE_BOUNDARY)
+    return 0;
+
+  parser->stats.slices_parsed_full++;
+
   if (pps->redundant_pic_cnt_present_flag == 1) {
     slc->redundant_pic_cnt = read_exp_golomb(buf);
   }
@@ -1127,11 +1297,11 @@ uint8_t parse_slice_header(struct buf_reader *buf, struct nal_unit *slc_nal,
 void interpret_slice_header(struct h264_parser *parser, struct nal_unit *slc_nal)
 {
   struct coded_picture *pic = parser->pic;
-  struct slice_header *slc = &slc_nal->slc;
+  struct slice_header *slc = slc_nal->slc;
 
   /* retrieve sps and pps from the buffers */
   struct nal_unit *pps_nal =
-      nal_buffer_get_by_pps_id(parser->pps_buffer, slc->pic_parameter_set_id);
+      nal_table_get(parser->pps_table, slc->pic_parameter_set_id);
 
   if (pps_nal == NULL) {
     xprintf(parser->xine, XINE_VERBOSITY_DEBUG,
@@ -1141,12 +1311,12 @@ void interpret_slice_header(struct h264_parser *parser, struct nal_unit *slc_nal
   }
 
   struct nal_unit *sps_nal =
-      nal_buffer_get_by_sps_id(parser->sps_buffer, pps_nal->pps.seq_parameter_set_id);
+      nal_table_get(parser->sps_table, pps_nal->pps->seq_parameter_set_id);
 
   if (sps_nal == NULL) {
     xprintf(parser->xine, XINE_VERBOSITY_DEBUG,
         "ERR: interpret_slice_header: seq_parameter_set_id %d not found in buffers\n",
-        pps_nal->pps.seq_parameter_set_id);
+        pps_nal->pps->seq_parameter_set_id);
     return;
   }
 
@@ -1213,11 +1383,11 @@ void parse_pred_weight_table(struct buf_reader *buf, struct slice_header *slc,
 {
   /* retrieve sps and pps from the buffers */
   struct pic_parameter_set_rbsp *pps =
-      &nal_buffer_get_by_pps_id(parser->pps_buffer, slc->pic_parameter_set_id)
+      nal_table_get(parser->pps_table, slc->pic_parameter_set_id)
       ->pps;
 
   struct seq_parameter_set_rbsp *sps =
-      &nal_buffer_get_by_sps_id(parser->sps_buffer, pps->seq_parameter_set_id)
+      nal_table_get(parser->sps_table, pps->seq_parameter_set_id)
       ->sps;
 
   slc->pred_weight_table.luma_log2_weight_denom = read_exp_golomb(buf);
@@ -1289,7 +1459,7 @@ void parse_pred_weight_table(struct buf_reader *buf, struct slice_header *slc,
 void calculate_pic_nums(struct h264_parser *parser, struct coded_picture *cpic)
 {
   struct decoded_picture *pic = NULL;
-  struct slice_header *cslc = &cpic->slc_nal->slc;
+  struct slice_header *cslc = cpic->slc_nal->slc;
 
   xine_list_iterator_t ite = xine_list_front(parser->dpb->reference_list);
   while (ite) {
@@ -1300,8 +1470,8 @@ void calculate_pic_nums(struct h264_parser *parser, struct coded_picture *cpic)
       if(pic->coded_pic[i] == NULL)
         continue;
 
-      struct slice_header *slc = &pic->coded_pic[i]->slc_nal->slc;
-      struct seq_parameter_set_rbsp *sps = &pic->coded_pic[i]->sps_nal->sps;
+      struct slice_header *slc = pic->coded_pic[i]->slc_nal->slc;
+      struct seq_parameter_set_rbsp *sps = pic->coded_pic[i]->sps_nal->sps;
 
       if (!pic->coded_pic[i]->used_for_long_term_ref) {
         int32_t frame_num_wrap = 0;
@@ -1347,7 +1517,7 @@ void execute_ref_pic_marking(struct coded_picture *cpic,
    */
   if (!cpic->slc_nal)
     return;
-  struct slice_header *slc = &cpic->slc_nal->slc;
+  struct slice_header *slc = cpic->slc_nal->slc;
   struct dpb *dpb = parser->dpb;
 
   calculate_pic_nums(parser, cpic);
@@ -1370,11 +1540,11 @@ void execute_ref_pic_marking(struct coded_picture *cpic,
         //% cpic->max_pic_num;
     struct decoded_picture* pic = NULL;
     if ((pic = dpb_get_picture(dpb, pic_num_x)) != NULL) {
-      if (cpic->slc_nal->slc.field_pic_flag == 0) {
+      if (cpic->slc_nal->slc->field_pic_flag == 0) {
         dpb_unmark_reference_picture(dpb, pic);
       } else {
 
-        if (pic->coded_pic[0]->slc_nal->slc.field_pic_flag == 1) {
+        if (pic->coded_pic[0]->slc_nal->slc->field_pic_flag == 1) {
           if (pic->top_is_reference)
             pic->top_is_reference = 0;
           else if (pic->bottom_is_reference)
@@ -1397,12 +1567,12 @@ void execute_ref_pic_marking(struct coded_picture *cpic,
     struct decoded_picture* pic = dpb_get_picture_by_ltpn(dpb,
         slc->dec_ref_pic_marking[marking_nr].long_term_pic_num);
     if (pic != NULL) {
-      if (cpic->slc_nal->slc.field_pic_flag == 0)
+      if (cpic->slc_nal->slc->field_pic_flag == 0)
         dpb_set_unused_ref_picture_byltpn(dpb,
             slc->dec_ref_pic_marking[marking_nr].long_term_pic_num);
       else {
 
-        if (pic->coded_pic[0]->slc_nal->slc.field_pic_flag == 1) {
+        if (pic->coded_pic[0]->slc_nal->slc->field_pic_flag == 1) {
           if (pic->top_is_reference)
             pic->top_is_reference = 0;
           else if (pic->bottom_is_reference)
@@ -1433,7 +1603,7 @@ void execute_ref_pic_marking(struct coded_picture *cpic,
     if (pic) {
       pic = dpb_get_picture(dpb, pic_num_x);
 
-      if (pic->coded_pic[0]->slc_nal->slc.field_pic_flag == 0) {
+      if (pic->coded_pic[0]->slc_nal->slc->field_pic_flag == 0) {
         pic->coded_pic[0]->long_term_frame_idx
             = slc->dec_ref_pic_marking[marking_nr].long_term_frame_idx;
         pic->coded_pic[0]->long_term_pic_num = pic->coded_pic[0]->long_term_frame_idx;
@@ -1502,7 +1672,7 @@ void execute_ref_pic_marking(struct coded_picture *cpic,
 void parse_dec_ref_pic_marking(struct buf_reader *buf,
     struct nal_unit *slc_nal)
 {
-  struct slice_header *slc = &slc_nal->slc;
+  struct slice_header *slc = slc_nal->slc;
 
   if (!slc)
     return;
@@ -1559,11 +1729,16 @@ void parse_dec_ref_pic_marking(struct buf_reader *buf,
 struct h264_parser* init_parser(xine_t *xine)
 {
   struct h264_parser *parser = calloc(1, sizeof(struct h264_parser));
-  parser->pic = create_coded_picture();
+  parser->nal_pool = create_nal_pool();
+  parser->pic_pool = create_coded_picture_pool();
+  parser->pic = create_coded_picture(parser->pic_pool);
   parser->position = NON_VCL;
   parser->last_vcl_nal = NULL;
-  parser->sps_buffer = create_nal_buffer(32);
-  parser->pps_buffer = create_nal_buffer(32);
+  parser->sps_table = create_nal_table(MAX_SPS_COUNT);
+  parser->pps_table = create_nal_table(MAX_PPS_COUNT);
+  parser->max_buf_size = MAX_BUF_SIZE;
+  parser->frame_parser = parse_frame_prebuf;
+  parser->slice_parse_mode = SLICE_PARSE_FULL;
   parser->xine = xine;
 #ifndef NOVDPAU
   parser->dpb = create_dpb();
@@ -1572,12 +1747,24 @@ struct h264_parser* init_parser(xine_t *xine)
   return parser;
 }
 
+/* the buffers are not freed here, so a reset
+ * on seek doesn't have to allocate them again */
 void reset_parser(struct h264_parser *parser)
 {
   parser->position = NON_VCL;
+#ifdef NOVDPAU
+  parser->privatebuf_len = 0;
+#endif
   parser->buf_len = parser->prebuf_len = 0;
+  parser->prebuf_start = 0;
   parser->next_nal_position = 0;
+  parser->scan_position = 0;
   parser->last_nal_res = 0;
+  parser->next_nal_size = 0;
+  parser->have_nal_size_length_buf = 0;
+  parser->have_nal_head = 0;
+  parser->au_pending = 0;
+  parser->nal_skip = 0;
 
   if(parser->last_vcl_nal) {
     release_nal_unit(parser->last_vcl_nal);
@@ -1593,7 +1780,7 @@ void reset_parser(struct h264_parser *parser)
 
   if(parser->pic != NULL) {
     free_coded_picture(parser->pic);
-    parser->pic = create_coded_picture();
+    parser->pic = create_coded_picture(parser->pic_pool);
   }
 }
 
@@ -1603,15 +1790,106 @@ void free_parser(struct h264_parser *parser)
   dpb_free_all(parser->dpb);
   release_dpb(parser->dpb);
 #endif
-  free_nal_buffer(parser->pps_buffer);
-  free_nal_buffer(parser->sps_buffer);
+  release_nal_unit(parser->last_vcl_nal);
+  free_nal_table(parser->pps_table);
+  free_nal_table(parser->sps_table);
   free(parser->nal_size_length_buf);
   if(parser->pic != NULL) {
     free_coded_picture(parser->pic);
   }
+#ifdef NOVDPAU
+  free(parser->privatebuf);
+#endif
+  free(parser->buf);
+  free(parser->outbuf);
+  free(parser->prebuf);
+  free_nal_pool(parser->nal_pool);
+  free_coded_picture_pool(parser->pic_pool);
   free(parser);
 }
 
+void set_parser_max_buf_size(struct h264_parser *parser, size_t size)
+{
+  /* buffers which are already larger are kept */
+  if(size < MIN_BUF_SIZE)
+    size = MIN_BUF_SIZE;
+  if(size > MAX_BUF_SIZE)
+    size = MAX_BUF_SIZE;
+  parser->max_buf_size = size;
+}
+
+void set_parser_slice_parse_mode(struct h264_parser *parser,
+    enum slice_parse_mode mode)
+{
+  parser->slice_parse_mode = mode;
+}
+
+void parser_swap_outbuf(struct h264_parser *parser, uint8_t **buf,
+    uint32_t *size)
+{
+  uint8_t *tmp_buf = parser->outbuf;
+  uint32_t tmp_size = parser->outbuf_size;
+
+  parser->outbuf = *buf;
+  parser->outbuf_size = *size;
+  *buf = tmp_buf;
+  *size = tmp_size;
+}
+
+uint32_t parser_buf_memory(struct h264_parser *parser)
+{
+  uint32_t size = parser->buf_size + parser->outbuf_size + parser->prebuf_size;
+#ifdef NOVDPAU
+  size += parser->privatebuf_size;
+#endif
+  return size;
+}
+
+/**
+ * make sure *buf can hold needed bytes. the buffer is allocated
+ * on first use and then grows by doubling, up to the cpb size of
+ * the stream's level, but never beyond max_buf_size.
+ * @return 0 if the buffer can't hold needed bytes
+ */
+static int grow_buf(struct h264_parser *parser, uint8_t **buf, uint32_t *size,
+    uint32_t needed)
+{
+  uint32_t limit, new_size;
+  uint8_t *new_buf;
+
+  if(needed <= *size)
+    return 1;
+
+  /* until the first sps tells the level the old fixed limit is used */
+  limit = parser->level_buf_size > 0 ? parser->level_buf_size : MAX_FRAME_SIZE;
+  if(limit > parser->max_buf_size)
+    limit = parser->max_buf_size;
+
+  if(needed > limit)
+    return 0;
+
+  new_size = *size > 0 ? *size : MIN_BUF_SIZE;
+  while(new_size < needed)
+    new_size *= 2;
+  if(new_size > limit)
+    new_size = limit;
+
+  new_buf = realloc(*buf, new_size);
+  if(new_buf == NULL) {
+    xprintf(parser->xine, XINE_VERBOSITY_LOG,
+        "h264_parser: can't allocate %u bytes\n", new_size);
+    return 0;
+  }
+
+  *buf = new_buf;
+  *size = new_size;
+
+  parser->stats.buf_grows++;
+  if(new_size > parser->stats.buf_peak_size)
+    parser->stats.buf_peak_size = new_size;
+  return 1;
+}
+
 void parse_codec_private(struct h264_parser *parser, uint8_t *inbuf, int inbuf_len)
 {
   struct buf_reader bufr;
@@ -1625,19 +1903,26 @@ void parse_codec_private(struct h264_parser *parser, uint8_t *inbuf, int inbuf_l
   bufr.cur_offset = 8;
   bufr.len = inbuf_len;
 
-  // FIXME: Might be broken!
-  struct nal_unit *nal = calloc(1, sizeof(struct nal_unit));
-
-
-  /* reserved */
+  /* configuration version, profile, compatibility and level; the
+   * sps which follow carry the same values */
+  read_bits(&bufr, 8);
+  read_bits(&bufr, 8);
   read_bits(&bufr, 8);
-  nal->sps.profile_idc = read_bits(&bufr, 8);
   read_bits(&bufr, 8);
-  nal->sps.level_idc = read_bits(&bufr, 8);
   read_bits(&bufr, 6);
 
   parser->nal_size_length = read_bits(&bufr, 2) + 1;
+  free(parser->nal_size_length_buf);
   parser->nal_size_length_buf = calloc(1, parser->nal_size_length);
+  parser->have_nal_size_length_buf = 0;
+  parser->have_nal_head = 0;
+  parser->next_nal_size = 0;
+
+  /* 4 byte length fields can be replaced by start codes in place */
+  if(parser->nal_size_length == 4)
+    parser->frame_parser = parse_frame_avcc;
+  else
+    parser->frame_parser = parse_frame_prebuf;
   read_bits(&bufr, 3);
   uint8_t sps_count = read_bits(&bufr, 5);
 
@@ -1654,16 +1939,19 @@ void parse_codec_private(struct h264_parser *parser, uint8_t *inbuf, int inbuf_l
     xprintf(parser->xine, XINE_VERBOSITY_LOG,"parse codec private SPS\n");
     /* copy SPS NALU's to privatebuf */
     static const uint8_t start_seq[4] = { 0x00, 0x00, 0x00, 0x01 };
-    if(nFirst) {
-       nFirst = 0;
-       xine_fast_memcpy(parser->privatebuf+parser->privatebuf_len, start_seq, 4);
-       parser->privatebuf_len+=4;
-    } else {
-       xine_fast_memcpy(parser->privatebuf+parser->privatebuf_len, start_seq + 1, 3);
-       parser->privatebuf_len+=3;
+    if(grow_buf(parser, &parser->privatebuf, &parser->privatebuf_size,
+          parser->privatebuf_len + 4 + sps_size)) {
+      if(nFirst) {
+         nFirst = 0;
+         xine_fast_memcpy(parser->privatebuf+parser->privatebuf_len, start_seq, 4);
+         parser->privatebuf_len+=4;
+      } else {
+         xine_fast_memcpy(parser->privatebuf+parser->privatebuf_len, start_seq + 1, 3);
+         parser->privatebuf_len+=3;
+      }
+      xine_fast_memcpy(parser->privatebuf+parser->privatebuf_len, inbuf, sps_size);
+      parser->privatebuf_len+=sps_size;
     }
-    xine_fast_memcpy(parser->privatebuf+parser->privatebuf_len, inbuf, sps_size);
-    parser->privatebuf_len+=sps_size;
 #endif
 
     parse_nal(inbuf, sps_size, parser, &dummy);
@@ -1686,23 +1974,24 @@ void parse_codec_private(struct h264_parser *parser, uint8_t *inbuf, int inbuf_l
     xprintf(parser->xine, XINE_VERBOSITY_LOG,"parse codec private PPS\n");
     /* copy PPS NALU's to privatebuf */
     static const uint8_t start_seq[4] = { 0x00, 0x00, 0x00, 0x01 };
-    if(nFirst) {
-       nFirst = 0;
-       xine_fast_memcpy(parser->privatebuf+parser->privatebuf_len, start_seq, 4);
-       parser->privatebuf_len+=4;
-    } else {
-       xine_fast_memcpy(parser->privatebuf+parser->privatebuf_len, start_seq + 1, 3);
-       parser->privatebuf_len+=3;
+    if(grow_buf(parser, &parser->privatebuf, &parser->privatebuf_size,
+          parser->privatebuf_len + 4 + pps_size)) {
+      if(nFirst) {
+         nFirst = 0;
+         xine_fast_memcpy(parser->privatebuf+parser->privatebuf_len, start_seq, 4);
+         parser->privatebuf_len+=4;
+      } else {
+         xine_fast_memcpy(parser->privatebuf+parser->privatebuf_len, start_seq + 1, 3);
+         parser->privatebuf_len+=3;
+      }
+      xine_fast_memcpy(parser->privatebuf+parser->privatebuf_len, inbuf, pps_size);
+      parser->privatebuf_len+=pps_size;
     }
-    xine_fast_memcpy(parser->privatebuf+parser->privatebuf_len, inbuf, pps_size);
-    parser->privatebuf_len+=pps_size;
 #endif
     parse_nal(inbuf, pps_size, parser, &dummy);
     inbuf += pps_size;
     inbuf_len -= pps_size;
   }
-
-  nal_buffer_append(parser->sps_buffer, nal);
 }
 
 #ifndef NOVDPAU
@@ -1710,15 +1999,15 @@ void process_mmc_operations(struct h264_parser *parser, struct coded_picture *pi
 {
   if (picture->flag_mask & REFERENCE) {
     parser->prev_pic_order_cnt_lsb
-          = picture->slc_nal->slc.pic_order_cnt_lsb;
+          = picture->slc_nal->slc->pic_order_cnt_lsb;
   }
 
   int i;
-  for(i = 0; i < picture->slc_nal->slc.
+  for(i = 0; i < picture->slc_nal->slc->
       dec_ref_pic_marking_count; i++) {
     execute_ref_pic_marking(
         picture,
-        picture->slc_nal->slc.dec_ref_pic_marking[i].
+        picture->slc_nal->slc->dec_ref_pic_marking[i].
         memory_management_control_operation,
         i,
         parser);
@@ -1726,8 +2015,52 @@ void process_mmc_operations(struct h264_parser *parser, struct coded_picture *pi
 }
 #endif
 
-int parse_frame(struct h264_parser *parser, uint8_t *inbuf, int inbuf_len,
-    int64_t pts,
+/* drop len bytes from the front of prebuf by advancing the read cursor */
+static inline void prebuf_consume(struct h264_parser *parser, uint32_t len)
+{
+  parser->prebuf_start += len;
+  parser->prebuf_len -= len;
+  if(parser->prebuf_len == 0)
+    parser->prebuf_start = 0;
+}
+
+/* move the unconsumed part of prebuf back to offset 0,
+ * only done when new input doesn't fit behind it anymore */
+static void prebuf_compact(struct h264_parser *parser)
+{
+  if(parser->prebuf_start == 0)
+    return;
+
+  memmove(parser->prebuf, parser->prebuf + parser->prebuf_start,
+      parser->prebuf_len);
+  parser->stats.bytes_moved += parser->prebuf_len;
+  parser->prebuf_start = 0;
+}
+
+#ifdef NOVDPAU
+/* the sps/pps from the codec private data go in front of the first
+ * access unit, this happens only once after parse_codec_private */
+static void prepend_privatebuf(struct h264_parser *parser)
+{
+  if(!grow_buf(parser, &parser->buf, &parser->buf_size,
+        parser->buf_len + parser->privatebuf_len)) {
+    xprintf(parser->xine, XINE_VERBOSITY_LOG,
+        "h264_parser: no space for codec private data\n");
+    return;
+  }
+
+  memmove(parser->buf + parser->privatebuf_len, parser->buf, parser->buf_len);
+  xine_fast_memcpy(parser->buf, parser->privatebuf, parser->privatebuf_len);
+  parser->buf_len += parser->privatebuf_len;
+  parser->stats.bytes_copied += parser->buf_len;
+  parser->privatebuf_len = 0;
+}
+#endif
+
+/* collects the input in prebuf and searches it for nal units,
+ * used for annex b streams and all nal_size_length != 4 */
+static int parse_frame_prebuf(struct h264_parser *parser, uint8_t *inbuf,
+    int inbuf_len, int64_t pts,
     uint8_t **ret_buf, uint32_t *ret_len, struct coded_picture **ret_pic)
 {
   int32_t next_nal = 0;
@@ -1741,12 +2074,18 @@ int parse_frame(struct h264_parser *parser, uint8_t *inbuf, int inbuf_len,
   if(parser->nal_size_length > 0)
     start_seq_len = offset = parser->nal_size_length;
 
-  if (parser->prebuf_len + inbuf_len > MAX_FRAME_SIZE) {
-    xprintf(parser->xine, XINE_VERBOSITY_LOG,"h264_parser: prebuf underrun\n");
-    *ret_len = 0;
-    *ret_buf = NULL;
-    parser->prebuf_len = 0;
-    return inbuf_len;
+  if (parser->prebuf_start + parser->prebuf_len + inbuf_len > parser->prebuf_size) {
+    prebuf_compact(parser);
+
+    if (!grow_buf(parser, &parser->prebuf, &parser->prebuf_size,
+          parser->prebuf_len + inbuf_len)) {
+      xprintf(parser->xine, XINE_VERBOSITY_LOG,"h264_parser: prebuf underrun\n");
+      *ret_len = 0;
+      *ret_buf = NULL;
+      parser->prebuf_len = parser->prebuf_start = 0;
+      parser->scan_position = 0;
+      return inbuf_len;
+    }
   }
 
   /* copy the whole inbuf to the prebuf,
@@ -1754,20 +2093,23 @@ int parse_frame(struct h264_parser *parser, uint8_t *inbuf, int inbuf_len,
    * if it's in there, parse the nal and append to parser->buf
    * or return a frame */
 
-  xine_fast_memcpy(parser->prebuf + parser->prebuf_len, inbuf, inbuf_len);
+  xine_fast_memcpy(parser->prebuf + parser->prebuf_start + parser->prebuf_len,
+      inbuf, inbuf_len);
   parser->prebuf_len += inbuf_len;
+  parser->stats.bytes_received += inbuf_len;
 
-  while((next_nal = seek_for_nal(parser->prebuf+start_seq_len-offset, parser->prebuf_len-start_seq_len+offset, parser)) > 0) {
+  while((next_nal = seek_for_nal(parser->prebuf+parser->prebuf_start+start_seq_len-offset, parser->prebuf_len-start_seq_len+offset, parser)) > 0) {
 
     struct coded_picture *completed_pic = NULL;
+    uint8_t *prebuf = parser->prebuf + parser->prebuf_start;
 
     if(!parser->nal_size_length &&
-        (parser->prebuf[0] != 0x00 || parser->prebuf[1] != 0x00 ||
-            parser->prebuf[2] != 0x01)) {
+        (prebuf[0] != 0x00 || prebuf[1] != 0x00 ||
+            prebuf[2] != 0x01)) {
       xprintf(parser->xine, XINE_VERBOSITY_LOG, "Broken NAL, skip it.\n");
       parser->last_nal_res = 2;
     } else {
-      parser->last_nal_res = parse_nal(parser->prebuf+start_seq_len,
+      parser->last_nal_res = parse_nal(prebuf+start_seq_len,
           next_nal, parser, &completed_pic);
     }
 
@@ -1777,22 +2119,23 @@ int parse_frame(struct h264_parser *parser, uint8_t *inbuf, int inbuf_len,
 
       //lprintf("Frame complete: %d bytes\n", parser->buf_len);
 #ifdef NOVDPAU
-      uint8_t *p;
-      *ret_len = parser->buf_len + parser->privatebuf_len;
-      *ret_buf = malloc(*ret_len);
-      p = *ret_buf;
-      if(parser->privatebuf_len >  0) {
-          xine_fast_memcpy(p, parser->privatebuf, parser->privatebuf_len);
-          p += parser->privatebuf_len;
-          parser->privatebuf_len = 0;
-      }
-      xine_fast_memcpy(p, parser->buf, parser->buf_len);
-#else
-      *ret_len = parser->buf_len;
-      *ret_buf = malloc(parser->buf_len);
-      xine_fast_memcpy(*ret_buf, parser->buf, parser->buf_len);
+      if(parser->privatebuf_len > 0)
+        prepend_privatebuf(parser);
 #endif
 
+      /* hand out the completed access unit without copying it, the
+       * next one is collected in the buffer returned by the last call */
+      uint8_t *tmp_buf = parser->outbuf;
+      uint32_t tmp_size = parser->outbuf_size;
+      parser->outbuf = parser->buf;
+      parser->outbuf_size = parser->buf_size;
+      parser->buf = tmp_buf;
+      parser->buf_size = tmp_size;
+
+      *ret_buf = parser->outbuf;
+      *ret_len = parser->buf_len;
+      parser->stats.au_count++;
+
       *ret_pic = completed_pic;
 
       parser->buf_len = 0;
@@ -1806,23 +2149,28 @@ int parse_frame(struct h264_parser *parser, uint8_t *inbuf, int inbuf_len,
        * we have to copy this to buffer for the next picture
        * now.
        */
-      if(parser->last_nal_res == 1) {
+      if(parser->last_nal_res == 1 &&
+          grow_buf(parser, &parser->buf, &parser->buf_size,
+            next_nal+start_seq_len-2*offset+3)) {
         if(parser->nal_size_length > 0) {
           static const uint8_t start_seq[3] = { 0x00, 0x00, 0x01 };
           xine_fast_memcpy(parser->buf, start_seq, 3);
           parser->buf_len += 3;
         }
 
-        xine_fast_memcpy(parser->buf+parser->buf_len, parser->prebuf+offset, next_nal+start_seq_len-2*offset);
+        xine_fast_memcpy(parser->buf+parser->buf_len, prebuf+offset, next_nal+start_seq_len-2*offset);
         parser->buf_len += next_nal+start_seq_len-2*offset;
+        parser->stats.bytes_copied += next_nal+start_seq_len-2*offset;
       }
 
-      memmove(parser->prebuf, parser->prebuf+(next_nal+start_seq_len-offset), parser->prebuf_len-(next_nal+start_seq_len-offset));
-      parser->prebuf_len -= next_nal+start_seq_len-offset;
+      prebuf_consume(parser, next_nal+start_seq_len-offset);
 
       return inbuf_len;
     }
 
+    /* an access unit without slices is dropped */
+    free_coded_picture(completed_pic);
+
     /* got a new nal, which is part of the current
      * coded picture. add it to buf
      */
@@ -1831,7 +2179,8 @@ int parse_frame(struct h264_parser *parser, uint8_t *inbuf, int inbuf_len,
 #else
     if (parser->last_nal_res < 2) {
 #endif
-      if (parser->buf_len + next_nal+start_seq_len-offset > MAX_FRAME_SIZE) {
+      if (!grow_buf(parser, &parser->buf, &parser->buf_size,
+            parser->buf_len + next_nal+start_seq_len-2*offset+3)) {
         xprintf(parser->xine, XINE_VERBOSITY_LOG, "h264_parser: buf underrun!\n");
         parser->buf_len = 0;
         *ret_len = 0;
@@ -1845,15 +2194,14 @@ int parse_frame(struct h264_parser *parser, uint8_t *inbuf, int inbuf_len,
         parser->buf_len += 3;
       }
 
-      xine_fast_memcpy(parser->buf+parser->buf_len, parser->prebuf+offset, next_nal+start_seq_len-2*offset);
+      xine_fast_memcpy(parser->buf+parser->buf_len, prebuf+offset, next_nal+start_seq_len-2*offset);
       parser->buf_len += next_nal+start_seq_len-2*offset;
+      parser->stats.bytes_copied += next_nal+start_seq_len-2*offset;
 
-      memmove(parser->prebuf, parser->prebuf+(next_nal+start_seq_len-offset), parser->prebuf_len-(next_nal+start_seq_len-offset));
-      parser->prebuf_len -= next_nal+start_seq_len-offset;
+      prebuf_consume(parser, next_nal+start_seq_len-offset);
     } else {
       /* got a non-relevant nal, just remove it */
-      memmove(parser->prebuf, parser->prebuf+(next_nal+start_seq_len-offset), parser->prebuf_len-(next_nal+start_seq_len-offset));
-      parser->prebuf_len -= next_nal+start_seq_len-offset;
+      prebuf_consume(parser, next_nal+start_seq_len-offset);
     }
   }
 
@@ -1866,6 +2214,251 @@ int parse_frame(struct h264_parser *parser, uint8_t *inbuf, int inbuf_len,
   return inbuf_len;
 }
 
+/* whether the nal with the header byte and the one after it in head, or
+ * only the header byte if head_len is 1, probably starts a new access
+ * unit. these are the rules of parse_nal, with first_mb_in_slice 0 taken
+ * for the first slice of a picture. parse_nal has the last word, a wrong
+ * guess costs a move of the nal */
+static int avcc_nal_starts_au(struct h264_parser *parser, const uint8_t *head,
+    int head_len)
+{
+  uint8_t nal_unit_type = head[0] & 0x1f;
+
+  if(!parser->pic || !parser->pic->slice_cnt)
+    return 0;
+
+  if(nal_unit_type == NAL_AU_DELIMITER)
+    return 1;
+  if(nal_unit_type >= NAL_SEI && nal_unit_type <= NAL_PPS)
+    return parser->position == VCL;
+  if(nal_unit_type >= NAL_SLICE && nal_unit_type <= NAL_SLICE_IDR)
+    return head_len > 1 && (head[1] & 0x80);
+  return 0;
+}
+
+static void avcc_swap_bufs(struct h264_parser *parser)
+{
+  uint8_t *tmp_buf = parser->outbuf;
+  uint32_t tmp_size = parser->outbuf_size;
+
+  parser->outbuf = parser->buf;
+  parser->outbuf_size = parser->buf_size;
+  parser->buf = tmp_buf;
+  parser->buf_size = tmp_size;
+}
+
+/* moves the nal at nal_start of buf, start code included, to offset dst
+ * of the other buffer and swaps the two. for a wrong guess of
+ * avcc_nal_starts_au, returns 0 if there was no space */
+static int avcc_move_nal(struct h264_parser *parser, uint32_t dst)
+{
+  uint32_t len = parser->buf_len - parser->nal_start;
+
+  if(!grow_buf(parser, &parser->outbuf, &parser->outbuf_size, dst + len))
+    return 0;
+
+  xine_fast_memcpy(parser->outbuf + dst, parser->buf + parser->nal_start, len);
+  parser->stats.bytes_copied += len;
+
+  avcc_swap_bufs(parser);
+  parser->nal_start = dst;
+  parser->buf_len = dst + len;
+  return 1;
+}
+
+/**
+ * length prefixed nal units with nal_size_length 4 are copied once,
+ * straight from inbuf to buf, and the length field is replaced by a
+ * 00 00 00 01 start code. the first two bytes of a nal tell
+ * avcc_nal_starts_au whether it starts a new access unit, which then stays
+ * in buf while the nal goes to the front of outbuf, and the two are
+ * swapped. the nal is parsed once it is complete, only if that proves the
+ * guess wrong it is moved.
+ * @return the number of bytes consumed from inbuf
+ */
+static int parse_frame_avcc(struct h264_parser *parser, uint8_t *inbuf,
+    int inbuf_len, int64_t pts,
+    uint8_t **ret_buf, uint32_t *ret_len, struct coded_picture **ret_pic)
+{
+  static const uint8_t start_seq[4] = { 0x00, 0x00, 0x00, 0x01 };
+  int pos = 0;
+
+  *ret_pic = NULL;
+  *ret_buf = NULL;
+  *ret_len = 0;
+
+  while(pos < inbuf_len) {
+    struct coded_picture *completed_pic = NULL;
+    uint32_t len, nal_len, au_len;
+
+    /* rest of a nal which didn't fit into the buffer */
+    if(parser->nal_skip > 0) {
+      len = inbuf_len - pos;
+      if(len > parser->nal_skip)
+        len = parser->nal_skip;
+      parser->nal_skip -= len;
+      pos += len;
+      continue;
+    }
+
+    if(parser->next_nal_size == 0) {
+      /* the length field might be split over two input buffers */
+      while(parser->have_nal_size_length_buf < 4 && pos < inbuf_len)
+        parser->nal_size_length_buf[parser->have_nal_size_length_buf++] = inbuf[pos++];
+      if(parser->have_nal_size_length_buf < 4)
+        break;
+
+      nal_len = (parser->nal_size_length_buf[0] << 24) |
+        (parser->nal_size_length_buf[1] << 16) |
+        (parser->nal_size_length_buf[2] << 8) |
+        parser->nal_size_length_buf[3];
+      if(nal_len == 0) {
+        parser->have_nal_size_length_buf = 0;
+        continue;
+      }
+      parser->next_nal_size = nal_len;
+    }
+
+    if(parser->have_nal_size_length_buf > 0) {
+      /* and so might be the bytes which say where the nal goes */
+      while(parser->have_nal_head < 2 && parser->have_nal_head < parser->next_nal_size &&
+          pos < inbuf_len)
+        parser->nal_head[parser->have_nal_head++] = inbuf[pos++];
+      if(parser->have_nal_head < 2 && parser->have_nal_head < parser->next_nal_size)
+        break;
+
+      nal_len = parser->next_nal_size;
+      parser->have_nal_size_length_buf = 0;
+
+      /* the access unit is complete, it waits in outbuf for the nal to
+       * be parsed */
+      if(avcc_nal_starts_au(parser, parser->nal_head, parser->have_nal_head)) {
+        avcc_swap_bufs(parser);
+        parser->au_pending = parser->buf_len;
+        parser->buf_len = 0;
+      }
+
+#ifdef NOVDPAU
+      /* the sps and pps of the codec private data go in front of the
+       * first access unit */
+      if(parser->buf_len == 0 && parser->privatebuf_len > 0 &&
+          grow_buf(parser, &parser->buf, &parser->buf_size, parser->privatebuf_len)) {
+        xine_fast_memcpy(parser->buf, parser->privatebuf, parser->privatebuf_len);
+        parser->buf_len = parser->privatebuf_len;
+        parser->stats.bytes_copied += parser->privatebuf_len;
+        parser->privatebuf_len = 0;
+      }
+#endif
+
+      if(!grow_buf(parser, &parser->buf, &parser->buf_size,
+            parser->buf_len + 4 + nal_len)) {
+        xprintf(parser->xine, XINE_VERBOSITY_LOG, "h264_parser: buf underrun!\n");
+        parser->buf_len = 0;
+        parser->au_pending = 0;
+        parser->nal_skip = nal_len - parser->have_nal_head;
+        parser->next_nal_size = 0;
+        parser->have_nal_head = 0;
+        continue;
+      }
+
+      /* the start code takes the place of the length field */
+      memcpy(parser->buf + parser->buf_len, start_seq, 4);
+      parser->nal_start = parser->buf_len;
+      parser->buf_len += 4;
+      xine_fast_memcpy(parser->buf + parser->buf_len, parser->nal_head, parser->have_nal_head);
+      parser->buf_len += parser->have_nal_head;
+      parser->stats.bytes_copied += parser->have_nal_head;
+      parser->next_nal_size -= parser->have_nal_head;
+      parser->have_nal_head = 0;
+    }
+
+    len = inbuf_len - pos;
+    if(len > parser->next_nal_size)
+      len = parser->next_nal_size;
+    xine_fast_memcpy(parser->buf + parser->buf_len, inbuf + pos, len);
+    parser->buf_len += len;
+    parser->stats.bytes_copied += len;
+    parser->next_nal_size -= len;
+    pos += len;
+
+    if(parser->next_nal_size > 0)
+      break;
+
+    /* the nal is complete now */
+    nal_len = parser->buf_len - parser->nal_start - 4;
+    parser->last_nal_res = parse_nal(parser->buf + parser->nal_start + 4,
+        nal_len, parser, &completed_pic);
+
+    if(completed_pic != NULL && completed_pic->slice_cnt > 0 &&
+        (parser->au_pending > 0 || parser->nal_start > 0)) {
+      if(parser->au_pending > 0) {
+        au_len = parser->au_pending;
+        parser->au_pending = 0;
+      } else {
+        /* guessed that the access unit goes on */
+        au_len = parser->nal_start;
+        if(!avcc_move_nal(parser, 0)) {
+          avcc_swap_bufs(parser);
+          parser->buf_len = 0;
+        }
+      }
+
+      *ret_buf = parser->outbuf;
+      *ret_len = au_len;
+      *ret_pic = completed_pic;
+      parser->stats.au_count++;
+
+      /* only a vcl nal which started the new coded picture is kept */
+      if(parser->last_nal_res != 1)
+        parser->buf_len = 0;
+
+      if (pts != 0 && (parser->pic->pts == 0 || parser->pic->pts != pts)) {
+        parser->pic->pts = pts;
+      }
+
+      parser->stats.bytes_received += pos;
+      return pos;
+    }
+
+    if(parser->au_pending > 0) {
+      /* guessed that a new access unit starts, the nal goes back behind
+       * the one waiting in outbuf */
+      if(!avcc_move_nal(parser, parser->au_pending)) {
+        avcc_swap_bufs(parser);
+        parser->buf_len = parser->nal_start = parser->au_pending;
+      }
+      parser->au_pending = 0;
+    }
+
+    /* an access unit without slices is dropped */
+    free_coded_picture(completed_pic);
+
+#ifdef NOVDPAU
+    if (parser->last_nal_res >= 3) {
+#else
+    if (parser->last_nal_res >= 2) {
+#endif
+      /* got a non-relevant nal, just remove it */
+      parser->buf_len = parser->nal_start;
+    }
+  }
+
+  if (pts != 0 && (parser->pic->pts == 0 || parser->pic->pts != pts)) {
+    parser->pic->pts = pts;
+  }
+
+  parser->stats.bytes_received += pos;
+  return pos;
+}
+
+int parse_frame(struct h264_parser *parser, uint8_t *inbuf, int inbuf_len,
+    int64_t pts,
+    uint8_t **ret_buf, uint32_t *ret_len, struct coded_picture **ret_pic)
+{
+  return parser->frame_parser(parser, inbuf, inbuf_len, pts,
+      ret_buf, ret_len, ret_pic);
+}
+
 
 /**
  * @return 0: NAL is part of coded picture
@@ -1903,7 +2496,7 @@ int parse_nal(uint8_t *buf, int buf_len, struct h264_parser *parser,
       nal->nal_unit_type == NAL_AU_DELIMITER) {
     /* start of a new access unit! */
     *completed_picture = parser->pic;
-    parser->pic = create_coded_picture();
+    parser->pic = create_coded_picture(parser->pic_pool);
 
     if(parser->last_vcl_nal != NULL) {
       release_nal_unit(parser->last_vcl_nal);
@@ -1916,10 +2509,15 @@ int parse_nal(uint8_t *buf, int buf_len, struct h264_parser *parser,
 
   switch(nal->nal_unit_type) {
     case NAL_SPS:
-      nal_buffer_append(parser->sps_buffer, nal);
+      if(nal_table_get(parser->sps_table, nal->sps->seq_parameter_set_id) != nal)
+        nal_table_store(parser->sps_table, nal->sps->seq_parameter_set_id,
+            nal, buf, buf_len);
+      set_level_buf_size(parser, nal->sps);
       break;
     case NAL_PPS:
-      nal_buffer_append(parser->pps_buffer, nal);
+      if(nal_table_get(parser->pps_table, nal->pps->pic_parameter_set_id) != nal)
+        nal_table_store(parser->pps_table, nal->pps->pic_parameter_set_id,
+            nal, buf, buf_len);
       break;
     case NAL_SEI: {
       if (parser->pic != NULL) {
@@ -1951,46 +2549,46 @@ int parse_nal(uint8_t *buf, int buf_len, struct h264_parser *parser,
 
     if (nal == NULL || last_nal == NULL) {
       ret = 1;
-    } else if (nal->slc.frame_num != last_nal->slc.frame_num) {
+    } else if (nal->slc->frame_num != last_nal->slc->frame_num) {
       ret = 1;
-    } else if (nal->slc.pic_parameter_set_id
-        != last_nal->slc.pic_parameter_set_id) {
+    } else if (nal->slc->pic_parameter_set_id
+        != last_nal->slc->pic_parameter_set_id) {
       ret = 1;
-    } else if (nal->slc.field_pic_flag
-        != last_nal->slc.field_pic_flag) {
+    } else if (nal->slc->field_pic_flag
+        != last_nal->slc->field_pic_flag) {
       ret = 1;
-    } else if (nal->slc.bottom_field_flag
-        != last_nal->slc.bottom_field_flag) {
+    } else if (nal->slc->bottom_field_flag
+        != last_nal->slc->bottom_field_flag) {
       ret = 1;
     } else if (nal->nal_ref_idc != last_nal->nal_ref_idc &&
         (nal->nal_ref_idc == 0 || last_nal->nal_ref_idc == 0)) {
       ret = 1;
-    } else if (nal->sps.pic_order_cnt_type == 0
-            && last_nal->sps.pic_order_cnt_type == 0
-            && (nal->slc.pic_order_cnt_lsb != last_nal->slc.pic_order_cnt_lsb
-                || nal->slc.delta_pic_order_cnt_bottom
-                != last_nal->slc.delta_pic_order_cnt_bottom)) {
+    } else if (nal->slc->pic_order_cnt_type == 0
+            && last_nal->slc->pic_order_cnt_type == 0
+            && (nal->slc->pic_order_cnt_lsb != last_nal->slc->pic_order_cnt_lsb
+                || nal->slc->delta_pic_order_cnt_bottom
+                != last_nal->slc->delta_pic_order_cnt_bottom)) {
       ret = 1;
-    } else if (nal->sps.pic_order_cnt_type == 1
-        && last_nal->sps.pic_order_cnt_type == 1
-        && (nal->slc.delta_pic_order_cnt[0]
-            != last_nal->slc.delta_pic_order_cnt[0]
-            || nal->slc.delta_pic_order_cnt[1]
-                != last_nal->slc.delta_pic_order_cnt[1])) {
+    } else if (nal->slc->pic_order_cnt_type == 1
+        && last_nal->slc->pic_order_cnt_type == 1
+        && (nal->slc->delta_pic_order_cnt[0]
+            != last_nal->slc->delta_pic_order_cnt[0]
+            || nal->slc->delta_pic_order_cnt[1]
+                != last_nal->slc->delta_pic_order_cnt[1])) {
       ret = 1;
     } else if (nal->nal_unit_type != last_nal->nal_unit_type && (nal->nal_unit_type
         == NAL_SLICE_IDR || last_nal->nal_unit_type == NAL_SLICE_IDR)) {
       ret = 1;
     } else if (nal->nal_unit_type == NAL_SLICE_IDR
-        && last_nal->nal_unit_type == NAL_SLICE_IDR && nal->slc.idr_pic_id
-        != last_nal->slc.idr_pic_id) {
+        && last_nal->nal_unit_type == NAL_SLICE_IDR && nal->slc->idr_pic_id
+        != last_nal->slc->idr_pic_id) {
       ret = 1;
     }
 
     /* increase the slice_cnt until a new frame is detected */
     if (ret && *completed_picture == NULL) {
       *completed_picture = parser->pic;
-      parser->pic = create_coded_picture();
+      parser->pic = create_coded_picture(parser->pic_pool);
     }
 
   } else if (nal->nal_unit_type == NAL_PPS || nal->nal_unit_type == NAL_SPS) {
@@ -2039,13 +2637,16 @@ int parse_nal(uint8_t *buf, int buf_len, struct h264_parser *parser,
       lock_nal_unit(nal);
       parser->pic->slc_nal = nal;
 
-      interpret_slice_header(parser, nal);
+      /* all slices of a picture refer to the same pps */
+      if (parser->slice_parse_mode == SLICE_PARSE_FULL ||
+          parser->pic->slice_cnt == 1)
+        interpret_slice_header(parser, nal);
     }
 
     if (*completed_picture != NULL &&
         (*completed_picture)->slice_cnt > 0) {
       calculate_pic_order(parser, *completed_picture,
-          &((*completed_picture)->slc_nal->slc));
+          (*completed_picture)->slc_nal->slc);
       interpret_sps(*completed_picture, parser);
       interpret_pps(*completed_picture);
     }
@@ -2091,13 +2692,21 @@ int seek_for_nal(uint8_t *buf, int buf_len, struct h264_parser *parser)
   if(buf[0] == NAL_END_OF_SEQUENCE)
     return 1;
 
-  int i;
-  for (i = 0; i < buf_len - 2; i++) {
-    if (buf[i] == 0x00 && buf[i + 1] == 0x00 && buf[i + 2] == 0x01) {
-      //lprintf("found nal at: %d\n", i);
-      return i;
-    }
+  /* continue where the last unsuccessful search stopped, the last two
+   * bytes are searched again as they might start a split start code */
+  uint32_t start = parser->scan_position;
+  int next_nal = find_start_code(buf + start, buf_len - start);
+
+  if(next_nal < 0) {
+    parser->stats.bytes_scanned += buf_len - start;
+    if(buf_len - 2 > (int)start)
+      parser->scan_position = buf_len - 2;
+    return -1;
   }
 
-  return -1;
+  /* the search stopped at the end of the start code found, the next one
+   * begins behind it */
+  parser->stats.bytes_scanned += next_nal + 3;
+  parser->scan_position = 0;
+  return start + next_nal;
 }
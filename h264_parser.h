@@ -31,7 +31,13 @@
 #include "dpb.h"
 #endif
 
+/* buffer limit until the level of the stream is known */
 #define MAX_FRAME_SIZE  1024*1024
+/* initial size of the parser buffers, they are allocated on first
+ * use and grow up to the cpb size of the stream's level */
+#define MIN_BUF_SIZE    64*1024
+/* default upper bound for the buffers, level 5.1 High 4:4:4 needs 144 MB */
+#define MAX_BUF_SIZE    64*1024*1024
 
 /* specifies wether the parser last parsed
  * non-vcl or vcl nal units. depending on
@@ -47,34 +53,108 @@ enum parser_flags {
     PIC_STRUCT_PRESENT = 0x02
 };
 
+/* how much of a slice header parse_nal reads */
+enum slice_parse_mode {
+    /* everything a software decoder needs for reference handling */
+    SLICE_PARSE_FULL,
+    /* only the fields needed for access unit boundary detection
+     * and the picture order count, for decoders in hardware */
+    SLICE_PARSE_BOUNDARY
+};
+
+struct coded_picture;
+
+/* reads the rbsp of a nal unit, emulation prevention bytes are skipped */
+struct buf_reader
+{
+  uint8_t *buf;
+  uint8_t *cur_pos;
+  int len;
+  int cur_offset;
+};
+
+/* counters for the parser hot path */
+struct h264_parser_stats {
+    uint64_t bytes_received;
+    /* bytes find_start_code searched. with scan_position every byte is
+     * searched once, but the last two of a failed search again */
+    uint64_t bytes_scanned;
+    uint64_t bytes_moved;
+    uint32_t buf_grows;
+    uint32_t buf_peak_size;
+    /* bytes copied into the access unit buffers */
+    uint64_t bytes_copied;
+    uint32_t au_count;
+    /* sps/pps which were identical to the stored ones */
+    uint32_t param_sets_repeated;
+    /* slice headers parsed, and how many of them completely */
+    uint32_t slices_parsed;
+    uint32_t slices_parsed_full;
+};
+
 struct h264_parser {
 #ifdef NOVDPAU
-    uint8_t privatebuf[MAX_FRAME_SIZE];
+    uint8_t *privatebuf;
     uint32_t privatebuf_len;
+    uint32_t privatebuf_size;
 #endif
-    uint8_t buf[MAX_FRAME_SIZE];
+    uint8_t *buf;
     uint32_t buf_len;
+    uint32_t buf_size;
+
+    /* access unit handed out by the last parse_frame call */
+    uint8_t *outbuf;
+    uint32_t outbuf_size;
 
     /* prebuf is used to store the currently
-     * processed nal unit */
-    uint8_t prebuf[MAX_FRAME_SIZE];
+     * processed nal unit, the unconsumed data starts
+     * at prebuf_start and is prebuf_len bytes long */
+    uint8_t *prebuf;
+    uint32_t prebuf_start;
     uint32_t prebuf_len;
+    uint32_t prebuf_size;
+
+    /* upper limit for the size of privatebuf, buf and prebuf */
+    uint32_t max_buf_size;
+    /* cpb size of the level of the last sps, 0 if none was seen yet */
+    uint32_t level_buf_size;
     uint32_t next_nal_position;
+    /* offset up to which prebuf was already searched for a start code */
+    uint32_t scan_position;
 
     uint8_t last_nal_res;
 
     uint8_t nal_size_length;
+    /* state of parse_frame_avcc: bytes of the current nal still to
+     * copy, its offset in buf and the bytes of a dropped nal to skip */
     uint32_t next_nal_size;
+    uint32_t nal_start;
+    uint32_t nal_skip;
     uint8_t *nal_size_length_buf;
     uint8_t have_nal_size_length_buf;
+    /* the first bytes of the current nal, which say where it goes */
+    uint8_t nal_head[2];
+    uint8_t have_nal_head;
+    /* length of the access unit in outbuf, which is returned once the
+     * nal which started the next one is parsed, 0 if none */
+    uint32_t au_pending;
+
+    /* parse_frame implementation, selected by parse_codec_private */
+    int (*frame_parser)(struct h264_parser *parser, uint8_t *inbuf,
+        int inbuf_len, int64_t pts,
+        uint8_t **ret_buf, uint32_t *ret_len, struct coded_picture **ret_pic);
 
     enum parser_position position;
+    enum slice_parse_mode slice_parse_mode;
 
     struct coded_picture *pic;
 
     struct nal_unit *last_vcl_nal;
-    struct nal_buffer *sps_buffer;
-    struct nal_buffer *pps_buffer;
+    struct nal_table *sps_table;
+    struct nal_table *pps_table;
+
+    struct nal_pool *nal_pool;
+    struct coded_picture_pool *pic_pool;
 
     uint32_t prev_pic_order_cnt_lsb;
     uint32_t prev_pic_order_cnt_msb;
@@ -93,6 +173,8 @@ struct h264_parser {
     struct dpb *dpb;
 #endif
 
+    struct h264_parser_stats stats;
+
     xine_t *xine;
 };
 
@@ -101,12 +183,28 @@ int parse_nal(uint8_t *buf, int buf_len, struct h264_parser *parser,
 
 int seek_for_nal(uint8_t *buf, int buf_len, struct h264_parser *parser);
 
+uint32_t read_exp_golomb(struct buf_reader *buf);
+int32_t read_exp_golomb_s(struct buf_reader *buf);
+
 struct h264_parser* init_parser(xine_t *xine);
 void reset_parser(struct h264_parser *parser);
 void free_parser(struct h264_parser *parser);
+void set_parser_max_buf_size(struct h264_parser *parser, size_t size);
+void set_parser_slice_parse_mode(struct h264_parser *parser,
+    enum slice_parse_mode mode);
+/* bytes currently allocated for the parser buffers */
+uint32_t parser_buf_memory(struct h264_parser *parser);
+/* ret_buf points into the parser, it must not be freed and
+ * stays valid until the next call of parse_frame.
+ */
 int parse_frame(struct h264_parser *parser, uint8_t *inbuf, int inbuf_len,
     int64_t pts,
     uint8_t **ret_buf, uint32_t *ret_len, struct coded_picture **ret_pic);
+/* takes the buffer returned by the last parse_frame call, which the
+ * caller may then keep, and gives the parser *buf (may be NULL) instead.
+ */
+void parser_swap_outbuf(struct h264_parser *parser, uint8_t **buf,
+    uint32_t *size);
 
 /* this has to be called after decoding the frame delivered by parse_frame,
  * but before adding a decoded frame to the dpb.
@@ -27,153 +27,190 @@
 #include "nal.h"
 #include <xine/xine_internal.h>
 
-struct nal_buffer* create_nal_buffer(uint8_t max_size)
+struct nal_table* create_nal_table(uint32_t size)
 {
-    struct nal_buffer *nal_buffer = calloc(1, sizeof(struct nal_buffer));
-    nal_buffer->max_size = max_size;
+  struct nal_table *table = calloc(1, sizeof(struct nal_table));
+  table->entries = calloc(size, sizeof(struct nal_table_entry));
+  table->size = size;
 
-    return nal_buffer;
+  return table;
 }
 
 /**
- * destroys a nal buffer. all referenced nals are released
+ * destroys a nal table. all referenced nals are released
  */
-void free_nal_buffer(struct nal_buffer *nal_buffer)
+void free_nal_table(struct nal_table *table)
 {
-  struct nal_unit *nal = nal_buffer->first;
+  nal_table_flush(table);
+  free(table->entries);
+  free(table);
+}
 
-  while (nal) {
-    struct nal_unit *delete = nal;
-    nal = nal->next;
-    release_nal_unit(delete);
+void nal_table_flush(struct nal_table *table)
+{
+  uint32_t i;
+
+  for(i = 0; i < table->size; i++) {
+    release_nal_unit(table->entries[i].nal);
+    free(table->entries[i].raw);
+    table->entries[i].nal = NULL;
+    table->entries[i].raw = NULL;
+    table->entries[i].raw_len = 0;
+    table->entries[i].raw_size = 0;
   }
-
-  free(nal_buffer);
+  table->last = NULL;
 }
 
 /**
- * appends a nal unit to the end of the buffer
+ * stores a nal unit under id, replacing the previous one.
+ * the raw nal is kept to recognize a repetition of it.
  */
-void nal_buffer_append(struct nal_buffer *nal_buffer, struct nal_unit *nal)
+void nal_table_store(struct nal_table *table, uint32_t id,
+    struct nal_unit *nal, const uint8_t *raw, uint32_t raw_len)
 {
-  if(nal_buffer->used == nal_buffer->max_size) {
-    nal_buffer_remove(nal_buffer, nal_buffer->first);
+  struct nal_table_entry *entry;
+
+  if(id >= table->size) {
+    lprintf("ERR: nal_table: id %d out of range\n", id);
+    return;
   }
 
-  if (nal_buffer->first == NULL) {
-    nal_buffer->first = nal_buffer->last = nal;
-    nal->prev = nal->next = NULL;
+  entry = &table->entries[id];
 
-    lock_nal_unit(nal);
-    nal_buffer->used++;
-  } else if (nal_buffer->last != NULL) {
-    nal_buffer->last->next = nal;
-    nal->prev = nal_buffer->last;
-    nal_buffer->last = nal;
+  lock_nal_unit(nal);
+  release_nal_unit(entry->nal);
+  entry->nal = nal;
 
-    lock_nal_unit(nal);
-    nal_buffer->used++;
-  } else {
-    lprintf("ERR: nal_buffer is in a broken state\n");
+  if(raw_len > entry->raw_size) {
+    free(entry->raw);
+    entry->raw = malloc(raw_len);
+    entry->raw_size = raw_len;
   }
+  xine_fast_memcpy(entry->raw, raw, raw_len);
+  entry->raw_len = raw_len;
+
+  table->last = nal;
 }
 
-void nal_buffer_remove(struct nal_buffer *nal_buffer, struct nal_unit *nal)
+/**
+ * returns the nal unit stored under id if it was
+ * parsed from exactly the same raw nal, NULL otherwise
+ */
+struct nal_unit* nal_table_get_repeated(struct nal_table *table, uint32_t id,
+    const uint8_t *raw, uint32_t raw_len)
 {
-  if (nal == nal_buffer->first && nal == nal_buffer->last) {
-    nal_buffer->first = nal_buffer->last = NULL;
-  } else {
-    if (nal == nal_buffer->first) {
-      nal_buffer->first = nal->next;
-      nal_buffer->first->prev = NULL;
-    } else {
-      nal->prev->next = nal->next;
-    }
+  struct nal_table_entry *entry;
 
-    if (nal == nal_buffer->last) {
-      nal_buffer->last = nal->prev;
-      nal_buffer->last->next = NULL;
-    } else {
-      nal->next->prev = nal->prev;
-    }
-  }
+  if(id >= table->size)
+    return NULL;
 
-  nal->next = nal->prev = NULL;
-  release_nal_unit(nal);
+  entry = &table->entries[id];
+  if(entry->nal == NULL || entry->raw_len != raw_len ||
+      memcmp(entry->raw, raw, raw_len) != 0)
+    return NULL;
 
-  nal_buffer->used--;
+  return entry->nal;
 }
 
-void nal_buffer_flush(struct nal_buffer *nal_buffer)
+struct nal_pool* create_nal_pool()
 {
-  while(nal_buffer->used > 0) {
-    nal_buffer_remove(nal_buffer, nal_buffer->first);
-  }
+  return calloc(1, sizeof(struct nal_pool));
 }
 
 /**
- * returns the last element in the buffer
+ * frees the pooled units. units which are still in use are
+ * freed on release, the pool itself with the last of them.
  */
-struct nal_unit *nal_buffer_get_last(struct nal_buffer *nal_buffer)
+void free_nal_pool(struct nal_pool *pool)
 {
-  return nal_buffer->last;
-}
+  int i;
 
-/**
- * get a nal unit from a nal_buffer from it's
- * seq parameter_set_id
- */
-struct nal_unit* nal_buffer_get_by_sps_id(struct nal_buffer *nal_buffer,
-    uint32_t seq_parameter_set_id)
-{
-  struct nal_unit *nal = nal_buffer->last;
-
-  if (nal != NULL) {
-    do {
-      if(nal->nal_unit_type == NAL_SPS) {
-        if(nal->sps.seq_parameter_set_id == seq_parameter_set_id) {
-          return nal;
-        }
-      }
-
-      nal = nal->prev;
-    } while(nal != NULL);
+  for(i = 0; i < NAL_PAYLOAD_COUNT; i++) {
+    while(pool->free_list[i]) {
+      struct nal_unit *nal = pool->free_list[i];
+      pool->free_list[i] = nal->next;
+      free(nal);
+    }
   }
 
-  return NULL;
+  pool->closed = 1;
+  if(pool->used == 0)
+    free(pool);
 }
 
-/**
- * get a nal unit from a nal_buffer from it's
- * pic parameter_set_id
- */
-struct nal_unit* nal_buffer_get_by_pps_id(struct nal_buffer *nal_buffer,
-    uint32_t pic_parameter_set_id)
+static enum nal_payload nal_payload_type(enum nal_unit_types nal_unit_type)
 {
-  struct nal_unit *nal = nal_buffer->last;
-
-  if (nal != NULL) {
-    do {
-      if(nal->nal_unit_type == NAL_PPS) {
-        if(nal->pps.pic_parameter_set_id == pic_parameter_set_id) {
-          return nal;
-        }
-      }
-
-      nal = nal->prev;
-    } while(nal != NULL);
+  switch(nal_unit_type) {
+    case NAL_SEI:
+      return NAL_PAYLOAD_SEI;
+    case NAL_SPS:
+      return NAL_PAYLOAD_SPS;
+    case NAL_PPS:
+      return NAL_PAYLOAD_PPS;
+    case NAL_SLICE:
+    case NAL_PART_A:
+    case NAL_PART_B:
+    case NAL_PART_C:
+    case NAL_SLICE_IDR:
+      return NAL_PAYLOAD_SLICE;
+    default:
+      return NAL_PAYLOAD_NONE;
   }
-
-  return NULL;
 }
 
+static const size_t nal_payload_size[NAL_PAYLOAD_COUNT] = {
+  0,
+  sizeof(struct sei_message),
+  sizeof(struct seq_parameter_set_rbsp),
+  sizeof(struct pic_parameter_set_rbsp),
+  sizeof(struct slice_header)
+};
+
 /**
- * create a new nal unit, with a lock_counter of 1
+ * create a new nal unit, with a lock_counter of 1 and a zeroed
+ * payload for nal_unit_type. it's taken from the pool if there
+ * is one with a free unit of that payload type
  */
-struct nal_unit* create_nal_unit()
+struct nal_unit* create_nal_unit(struct nal_pool *pool,
+    enum nal_unit_types nal_unit_type)
 {
-  struct nal_unit *nal = calloc(1, sizeof(struct nal_unit));
+  enum nal_payload payload = nal_payload_type(nal_unit_type);
+  size_t size = sizeof(struct nal_unit) + nal_payload_size[payload];
+  struct nal_unit *nal;
+
+  if(pool && pool->free_list[payload]) {
+    nal = pool->free_list[payload];
+    pool->free_list[payload] = nal->next;
+    memset(nal, 0, size);
+  } else {
+    nal = calloc(1, size);
+    if(pool)
+      pool->allocated++;
+  }
+
+  nal->nal_unit_type = nal_unit_type;
+  switch(payload) {
+    case NAL_PAYLOAD_SEI:
+      nal->sei = (struct sei_message *)(nal + 1);
+      break;
+    case NAL_PAYLOAD_SPS:
+      nal->sps = (struct seq_parameter_set_rbsp *)(nal + 1);
+      break;
+    case NAL_PAYLOAD_PPS:
+      nal->pps = (struct pic_parameter_set_rbsp *)(nal + 1);
+      break;
+    case NAL_PAYLOAD_SLICE:
+      nal->slc = (struct slice_header *)(nal + 1);
+      break;
+    default:
+      break;
+  }
+
   nal->lock_counter = 1;
+  nal->pool = pool;
+
+  if(pool && ++pool->used > pool->high_water)
+    pool->high_water = pool->used;
 
   return nal;
 }
@@ -191,19 +228,40 @@ void release_nal_unit(struct nal_unit *nal)
   nal->lock_counter--;
 
   if(nal->lock_counter <= 0) {
-    free(nal);
+    struct nal_pool *pool = nal->pool;
+
+    if(!pool) {
+      free(nal);
+      return;
+    }
+
+    pool->used--;
+    if(pool->closed) {
+      free(nal);
+      if(pool->used == 0)
+        free(pool);
+    } else {
+      enum nal_payload payload = nal_payload_type(nal->nal_unit_type);
+      nal->next = pool->free_list[payload];
+      pool->free_list[payload] = nal;
+    }
   }
 }
 
 /**
- * creates a copy of a nal unit with a single lock
+ * copies a nal unit into dest, which has to be created
+ * for the same nal_unit_type. dest keeps a single lock
  */
 void copy_nal_unit(struct nal_unit *dest, struct nal_unit *src)
 {
-  /* size without pps, sps and slc units: */
-  int size = sizeof(struct nal_unit);
+  enum nal_payload payload = nal_payload_type(src->nal_unit_type);
+
+  if(payload != nal_payload_type(dest->nal_unit_type)) {
+    lprintf("ERR: copy_nal_unit: payload types differ\n");
+    return;
+  }
 
-  xine_fast_memcpy(dest, src, size);
-  dest->lock_counter = 1;
-  dest->prev = dest->next = NULL;
+  dest->nal_ref_idc = src->nal_ref_idc;
+  dest->nal_unit_type = src->nal_unit_type;
+  xine_fast_memcpy(dest + 1, src + 1, nal_payload_size[payload]);
 }
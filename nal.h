@@ -22,6 +22,7 @@
 
 #ifndef NAL_H_
 #define NAL_H_
+#include <stddef.h>
 #include <stdint.h>
 #ifndef NOVDPAU
 #include <vdpau/vdpau.h>
@@ -380,6 +381,9 @@ struct slice_header
   uint8_t bottom_field_flag;
   uint32_t idr_pic_id;
 
+  /* copied from the sps, needed for the access unit boundary detection */
+  uint32_t pic_order_cnt_type;
+
   /* sps->pic_order_cnt_type == 0 */
   uint32_t pic_order_cnt_lsb;
   int32_t delta_pic_order_cnt_bottom;
@@ -399,6 +403,8 @@ struct slice_header
   /* slice type == B */
   uint32_t num_ref_idx_l1_active_minus1;
 
+  /* the rest is only parsed for vdpau */
+#ifndef NOVDPAU
   /* ref_pic_list_reordering */
   struct
   {
@@ -457,46 +463,96 @@ struct slice_header
     uint32_t max_long_term_frame_idx_plus1;
   } dec_ref_pic_marking[10];
   uint32_t dec_ref_pic_marking_count;
+#endif
 };
 
+/* the payload of a nal unit is allocated behind it, with
+ * the size needed for its nal_unit_type. only the pointer
+ * matching the type is set, all others are NULL.
+ */
 struct nal_unit {
     uint8_t nal_ref_idc; // 0x03
     enum nal_unit_types nal_unit_type; // 0x1f
 
-    //union {
-      struct sei_message sei;
-      struct seq_parameter_set_rbsp sps;
-      struct pic_parameter_set_rbsp pps;
-      struct slice_header slc;
-    //};
+    struct sei_message *sei;
+    struct seq_parameter_set_rbsp *sps;
+    struct pic_parameter_set_rbsp *pps;
+    struct slice_header *slc;
 
-    struct nal_unit *prev;
+    /* free list link while the unit is in its pool */
     struct nal_unit *next;
+    struct nal_pool *pool;
 
     uint32_t lock_counter;
 };
 
-struct nal_buffer {
-    struct nal_unit *first;
-    struct nal_unit *last;
+enum nal_payload {
+    NAL_PAYLOAD_NONE,
+    NAL_PAYLOAD_SEI,
+    NAL_PAYLOAD_SPS,
+    NAL_PAYLOAD_PPS,
+    NAL_PAYLOAD_SLICE,
+    NAL_PAYLOAD_COUNT
+};
+
+/* recycles the nal units of one parser instead of freeing them */
+struct nal_pool {
+    /* one free list per payload type */
+    struct nal_unit *free_list[NAL_PAYLOAD_COUNT];
+
+    uint32_t used;
+    uint32_t high_water;
+    uint32_t allocated;
 
-    uint8_t max_size;
-    uint8_t used;
+    /* set when the owner is gone, released units are freed then */
+    uint8_t closed;
 };
 
-struct nal_buffer* create_nal_buffer(uint8_t max_size);
-void free_nal_buffer(struct nal_buffer *nal_buffer);
-void nal_buffer_append(struct nal_buffer *nal_buffer, struct nal_unit *nal);
-void nal_buffer_remove(struct nal_buffer *nal_buffer, struct nal_unit *nal);
-void nal_buffer_flush(struct nal_buffer *nal_buffer);
+/* parameter sets indexed by their id */
+#define MAX_SPS_COUNT 32
+#define MAX_PPS_COUNT 256
+
+struct nal_table_entry {
+    struct nal_unit *nal;
+
+    /* the nal unit was parsed from these bytes */
+    uint8_t *raw;
+    uint32_t raw_len;
+    uint32_t raw_size;
+};
+
+struct nal_table {
+    struct nal_table_entry *entries;
+    uint32_t size;
+
+    /* the nal unit stored last */
+    struct nal_unit *last;
+};
+
+struct nal_table* create_nal_table(uint32_t size);
+void free_nal_table(struct nal_table *table);
+void nal_table_flush(struct nal_table *table);
+void nal_table_store(struct nal_table *table, uint32_t id,
+    struct nal_unit *nal, const uint8_t *raw, uint32_t raw_len);
+struct nal_unit* nal_table_get_repeated(struct nal_table *table, uint32_t id,
+    const uint8_t *raw, uint32_t raw_len);
+
+static inline struct nal_unit* nal_table_get(struct nal_table *table,
+    uint32_t id)
+{
+  return id < table->size ? table->entries[id].nal : NULL;
+}
+
+static inline struct nal_unit* nal_table_get_last(struct nal_table *table)
+{
+  return table->last;
+}
 
-struct nal_unit* nal_buffer_get_by_sps_id(struct nal_buffer *nal_buffer,
-    uint32_t seq_parameter_set_id);
-struct nal_unit* nal_buffer_get_by_pps_id(struct nal_buffer *nal_buffer,
-    uint32_t pic_parameter_set_id);
-struct nal_unit* nal_buffer_get_last(struct nal_buffer *nal_buffer);
+struct nal_pool* create_nal_pool(void);
+void free_nal_pool(struct nal_pool *pool);
 
-struct nal_unit* create_nal_unit(void);
+struct nal_unit* create_nal_unit(struct nal_pool *pool,
+    enum nal_unit_types nal_unit_type);
 void lock_nal_unit(struct nal_unit *nal);
 void release_nal_unit(struct nal_unit *nal);
 void copy_nal_unit(struct nal_unit *dest, struct nal_unit *src);
@@ -0,0 +1,152 @@
+#include <string.h>
+
+#include "startcode.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+static int find_start_code_bytes( const uint8_t *buf, int pos, int len )
+{
+  for ( ; pos < len - 2; pos++ ) {
+    if ( buf[pos] == 0x00 && buf[pos+1] == 0x00 && buf[pos+2] == 0x01 )
+      return pos;
+  }
+  return -1;
+}
+
+static int find_start_code_scalar( const uint8_t *buf, int len )
+{
+  return find_start_code_bytes( buf, 0, len );
+}
+
+/*
+ * word-at-a-time scan: a start code can only begin inside a word
+ * which contains at least one zero byte, all other words are skipped.
+ */
+static int find_start_code_c( const uint8_t *buf, int len )
+{
+  const uint64_t ones = 0x0101010101010101ULL;
+  const uint64_t highs = 0x8080808080808080ULL;
+  int pos = 0;
+
+  while ( pos + 8 + 2 <= len ) {
+    uint64_t w;
+    memcpy( &w, buf + pos, sizeof(w) );
+    if ( (w - ones) & ~w & highs ) {
+      int end = pos + 8;
+      for ( ; pos < end; pos++ ) {
+        if ( buf[pos] == 0x00 && buf[pos+1] == 0x00 && buf[pos+2] == 0x01 )
+          return pos;
+      }
+    } else {
+      pos += 8;
+    }
+  }
+
+  return find_start_code_bytes( buf, pos, len );
+}
+
+#ifdef HAVE_X86_SIMD
+__attribute__((target("sse2")))
+static int find_start_code_sse2( const uint8_t *buf, int len )
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi8( 1 );
+  int pos = 0;
+
+  /* compare 16 candidate positions at once, the loads at +1 and +2
+   * must stay inside the buffer */
+  while ( pos + 16 + 2 <= len ) {
+    __m128i b0 = _mm_loadu_si128( (const __m128i *)(buf + pos) );
+    __m128i b1 = _mm_loadu_si128( (const __m128i *)(buf + pos + 1) );
+    __m128i b2 = _mm_loadu_si128( (const __m128i *)(buf + pos + 2) );
+    __m128i m = _mm_and_si128( _mm_and_si128( _mm_cmpeq_epi8( b0, zero ),
+        _mm_cmpeq_epi8( b1, zero ) ), _mm_cmpeq_epi8( b2, one ) );
+    int mask = _mm_movemask_epi8( m );
+    if ( mask )
+      return pos + __builtin_ctz( mask );
+    pos += 16;
+  }
+
+  return find_start_code_bytes( buf, pos, len );
+}
+
+__attribute__((target("avx2")))
+static int find_start_code_avx2( const uint8_t *buf, int len )
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one = _mm256_set1_epi8( 1 );
+  int pos = 0, ret;
+
+  while ( pos + 32 + 2 <= len ) {
+    __m256i b0 = _mm256_loadu_si256( (const __m256i *)(buf + pos) );
+    __m256i b1 = _mm256_loadu_si256( (const __m256i *)(buf + pos + 1) );
+    __m256i b2 = _mm256_loadu_si256( (const __m256i *)(buf + pos + 2) );
+    __m256i m = _mm256_and_si256( _mm256_and_si256( _mm256_cmpeq_epi8( b0, zero ),
+        _mm256_cmpeq_epi8( b1, zero ) ), _mm256_cmpeq_epi8( b2, one ) );
+    uint32_t mask = (uint32_t)_mm256_movemask_epi8( m );
+    if ( mask )
+      return pos + __builtin_ctz( mask );
+    pos += 32;
+  }
+
+  ret = find_start_code_sse2( buf + pos, len - pos );
+  return ret < 0 ? -1 : pos + ret;
+}
+#endif
+
+static int find_start_code_init( const uint8_t *buf, int len );
+
+static int (*find_start_code_impl)( const uint8_t *buf, int len ) = find_start_code_init;
+
+static int find_start_code_init( const uint8_t *buf, int len )
+{
+  int (*impl)( const uint8_t *, int ) = find_start_code_c;
+
+#ifdef HAVE_X86_SIMD
+  __builtin_cpu_init();
+  if ( __builtin_cpu_supports( "avx2" ) )
+    impl = find_start_code_avx2;
+  else if ( __builtin_cpu_supports( "sse2" ) )
+    impl = find_start_code_sse2;
+#endif
+
+  find_start_code_impl = impl;
+  return impl( buf, len );
+}
+
+int find_start_code( const uint8_t *buf, int len )
+{
+  if ( len < 3 )
+    return -1;
+  return find_start_code_impl( buf, len );
+}
+
+start_code_func find_start_code_kernel( enum start_code_kernel kernel )
+{
+  switch ( kernel ) {
+    case START_CODE_BYTES:
+      return find_start_code_scalar;
+    case START_CODE_WORD:
+      return find_start_code_c;
+#ifdef HAVE_X86_SIMD
+    case START_CODE_SSE2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports( "sse2" ) ? find_start_code_sse2 : NULL;
+    case START_CODE_AVX2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports( "avx2" ) ? find_start_code_avx2 : NULL;
+#endif
+    default:
+      return NULL;
+  }
+}
+
+const char *find_start_code_kernel_name( enum start_code_kernel kernel )
+{
+  static const char *names[START_CODE_KERNELS] = { "bytes", "word", "sse2", "avx2" };
+
+  return kernel < START_CODE_KERNELS ? names[kernel] : "unknown";
+}
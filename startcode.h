@@ -0,0 +1,28 @@
+#ifndef STARTCODE_H
+#define STARTCODE_H
+
+#include <stdint.h>
+
+/*
+ * returns the offset of the first 00 00 01 start code prefix which
+ * completely fits into buf[0..len), or -1 if there is none.
+ * the SSE2/AVX2/generic implementation is selected at runtime.
+ */
+int find_start_code( const uint8_t *buf, int len );
+
+/* the implementations behind find_start_code, for the bench */
+enum start_code_kernel {
+  START_CODE_BYTES,
+  START_CODE_WORD,
+  START_CODE_SSE2,
+  START_CODE_AVX2,
+  START_CODE_KERNELS
+};
+
+typedef int (*start_code_func)( const uint8_t *buf, int len );
+
+/* returns NULL if the kernel is not built in or the cpu lacks it */
+start_code_func find_start_code_kernel( enum start_code_kernel kernel );
+const char *find_start_code_kernel_name( enum start_code_kernel kernel );
+
+#endif